@@ -0,0 +1,204 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "analysis.h"
+#include "common.h"
+
+void analysis_init(struct analysis *analysis)
+{
+	assert(analysis != NULL);
+
+	memset(analysis, 0, sizeof(struct analysis));
+}
+
+static void end_block(struct analysis *analysis, uint8_t Cs)
+{
+	unsigned last = analysis->last > 64 ? 64 : analysis->last;
+
+	analysis->eob[last]++;
+
+	if (last == 1) {
+		analysis->component[Cs].zero_ac_blocks++;
+	}
+
+	/* until the next DC */
+	analysis->k = 64;
+}
+
+void analysis_dc(struct analysis *analysis, uint8_t Cs, uint8_t Td, const struct hcode *hcode, uint8_t cat)
+{
+	assert(analysis != NULL);
+	assert(hcode != NULL);
+	assert(Td < 4 && cat < 16);
+
+	struct analysis_component *component = &analysis->component[Cs];
+	uint8_t size = hcode->e_huf_si[cat];
+
+	component->blocks++;
+	component->dc_code_bits += size;
+	component->dc_extra_bits += cat;
+
+	analysis->freq[0][Td][cat]++;
+	analysis->code_bits[0][Td] += size;
+	analysis->dc_category[cat]++;
+
+	analysis->k = 1;
+	analysis->last = 1;
+	analysis->run = 0;
+}
+
+void analysis_ac(struct analysis *analysis, uint8_t Cs, uint8_t Ta, const struct hcode *hcode, uint8_t rs)
+{
+	assert(analysis != NULL);
+	assert(hcode != NULL);
+	assert(Ta < 4);
+
+	struct analysis_component *component = &analysis->component[Cs];
+	uint8_t size = hcode->e_huf_si[rs];
+	/* RRRRSSSS */
+	uint8_t R = rs >> 4;
+	uint8_t S = rs & 15;
+
+	component->ac_code_bits += size;
+	component->ac_extra_bits += S;
+
+	analysis->freq[1][Ta][rs]++;
+	analysis->code_bits[1][Ta] += size;
+	analysis->rs[rs]++;
+
+	if (rs == 0x00) {
+		/* EOB */
+		end_block(analysis, Cs);
+		return;
+	}
+
+	if (rs == 0xf0) {
+		/* ZRL */
+		analysis->run += 16;
+		analysis->k += 16;
+	} else {
+		analysis->run += R;
+		analysis->zero_run[analysis->run > 63 ? 63 : analysis->run]++;
+		analysis->ac_category[S]++;
+		analysis->k += R + 1;
+		analysis->last = analysis->k;
+		analysis->run = 0;
+	}
+
+	if (analysis->k >= 64) {
+		end_block(analysis, Cs);
+	}
+}
+
+static double percent(uint64_t part, uint64_t total)
+{
+	return total ? 100. * (double)part / (double)total : 0.;
+}
+
+/* the bits per symbol of the ideal code for the frequencies */
+static double entropy(const uint64_t freq[256], uint64_t total)
+{
+	double h = 0.;
+
+	for (int v = 0; v < 256; ++v) {
+		if (freq[v] != 0) {
+			double p = (double)freq[v] / (double)total;
+
+			h -= p * log2(p);
+		}
+	}
+
+	return h;
+}
+
+static void report_histogram(FILE *stream, const char *title, const char *label, const uint64_t *count, size_t size, int rs)
+{
+	uint64_t total = 0;
+
+	for (size_t i = 0; i < size; ++i) {
+		total += count[i];
+	}
+
+	fprintf(stream, "\n%s\n%-8s %14s %8s\n", title, label, "count", "%");
+
+	for (size_t i = 0; i < size; ++i) {
+		if (count[i] == 0) {
+			continue;
+		}
+
+		if (rs) {
+			fprintf(stream, "%2zu/%-5zu %14" PRIu64 " %8.3f\n", i >> 4, i & 15, count[i], percent(count[i], total));
+		} else {
+			fprintf(stream, "%-8zu %14" PRIu64 " %8.3f\n", i, count[i], percent(count[i], total));
+		}
+	}
+}
+
+void analysis_report(const struct analysis *analysis, const char *tool, FILE *stream)
+{
+	assert(analysis != NULL);
+	assert(tool != NULL);
+	assert(stream != NULL);
+
+	uint64_t total_bits = 0;
+
+	for (int i = 0; i < 256; ++i) {
+		const struct analysis_component *component = &analysis->component[i];
+
+		total_bits += component->dc_code_bits + component->dc_extra_bits + component->ac_code_bits + component->ac_extra_bits;
+	}
+
+	fprintf(stream, "bitstream analysis (%s), %" PRIu64 " bits\n\n", tool, total_bits);
+
+	fprintf(stream, "%-9s %10s %9s %14s %14s %8s %8s %10s\n",
+		"component", "blocks", "zero AC%", "DC bits", "AC bits", "DC%", "total%", "bits/block");
+
+	for (int i = 0; i < 256; ++i) {
+		const struct analysis_component *component = &analysis->component[i];
+
+		if (component->blocks == 0) {
+			continue;
+		}
+
+		uint64_t dc = component->dc_code_bits + component->dc_extra_bits;
+		uint64_t ac = component->ac_code_bits + component->ac_extra_bits;
+
+		fprintf(stream, "%-9i %10" PRIu64 " %9.3f %14" PRIu64 " %14" PRIu64 " %8.3f %8.3f %10.3f\n",
+			i, component->blocks, percent(component->zero_ac_blocks, component->blocks), dc, ac,
+			percent(dc, dc + ac), percent(dc + ac, total_bits), (double)(dc + ac) / (double)component->blocks);
+	}
+
+	/* the extra bits are not Huffman-coded, the bound is for the codes alone */
+	fprintf(stream, "\n%-9s %14s %14s %10s %10s %10s\n",
+		"table", "symbols", "code bits", "avg bits", "entropy", "overhead%");
+
+	for (int j = 0; j < 2; ++j) {
+		for (int i = 0; i < 4; ++i) {
+			uint64_t symbols = 0;
+
+			for (int v = 0; v < 256; ++v) {
+				symbols += analysis->freq[j][i][v];
+			}
+
+			if (symbols == 0) {
+				continue;
+			}
+
+			double avg = (double)analysis->code_bits[j][i] / (double)symbols;
+			double h = entropy(analysis->freq[j][i], symbols);
+
+			fprintf(stream, "%s%-7i %14" PRIu64 " %14" PRIu64 " %10.4f %10.4f %10.3f\n",
+				j ? "AC" : "DC", i, symbols, analysis->code_bits[j][i], avg, h, h > 0. ? 100. * (avg - h) / h : 0.);
+		}
+	}
+
+	report_histogram(stream, "DC categories", "SSSS", analysis->dc_category, 16, 0);
+	report_histogram(stream, "AC categories", "SSSS", analysis->ac_category, 16, 0);
+	report_histogram(stream, "zero runs", "zeros", analysis->zero_run, 64, 0);
+	report_histogram(stream, "EOB positions (64 = no EOB)", "k", analysis->eob, 65, 0);
+	report_histogram(stream, "RS symbols", "R/S", analysis->rs, 256, 1);
+}
@@ -0,0 +1,62 @@
+#ifndef JPEG_ANALYSIS_H
+#define JPEG_ANALYSIS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+struct hcode;
+
+/* the bits of a single component */
+struct analysis_component {
+	uint64_t blocks;
+	/* blocks with the DC coefficient only */
+	uint64_t zero_ac_blocks;
+
+	/* Huffman codes, and the extra bits */
+	uint64_t dc_code_bits, dc_extra_bits;
+	uint64_t ac_code_bits, ac_extra_bits;
+};
+
+/*
+ * Where the bits of the entropy-coded data go.
+ *
+ * The symbols are counted as they are read or written, one block after the
+ * other, by the decoder and the encoder alike. The bits are those of the
+ * Huffman codes and of the extra bits; the byte stuffing, the padding, and
+ * the markers are not included.
+ */
+struct analysis {
+	/* indexed by the component in the order of the frame header */
+	struct analysis_component component[256];
+
+	/* the symbols coded with each table, [0=DC/1=AC][identifier] */
+	uint64_t freq[2][4][256];
+	uint64_t code_bits[2][4];
+
+	/* the AC symbols (RRRRSSSS) */
+	uint64_t rs[256];
+	/* the zeros preceding each nonzero AC coefficient, ZRLs included */
+	uint64_t zero_run[64];
+	/* the zig-zag index after the last nonzero coefficient, 64 = no EOB */
+	uint64_t eob[65];
+	/* the categories (SSSS) */
+	uint64_t dc_category[16];
+	uint64_t ac_category[16];
+
+	/* the block being coded */
+	unsigned k, last, run;
+};
+
+void analysis_init(struct analysis *analysis);
+
+/* the DC symbol starts the block of the component Cs, coded with the table Td */
+void analysis_dc(struct analysis *analysis, uint8_t Cs, uint8_t Td, const struct hcode *hcode, uint8_t cat);
+
+/* the AC symbol, the block ends with EOB or the last position */
+void analysis_ac(struct analysis *analysis, uint8_t Cs, uint8_t Ta, const struct hcode *hcode, uint8_t rs);
+
+/* the tables and histograms as text */
+void analysis_report(const struct analysis *analysis, const char *tool, FILE *stream);
+
+#endif
@@ -0,0 +1,306 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "arena.h"
+#include "mem.h"
+#include "common.h"
+
+/* smallest chunk mapped */
+#define ARENA_CHUNK ((size_t)1 << 20)
+
+/* size of the transparent huge page on x86-64 */
+#define ARENA_HUGE_PAGE ((size_t)2 << 20)
+
+/* the header is placed at the beginning of the mapping */
+struct chunk {
+	struct chunk *next;
+
+	/* size of the mapping */
+	size_t size;
+
+	/* offset of the free space from the beginning of the mapping */
+	size_t used;
+
+	/* the memory from this offset on is still zero */
+	size_t clean;
+};
+
+struct arena {
+	/* the chunk being allocated from, followed by the full ones */
+	struct chunk *chunk;
+
+	/* directory of the backing files, NULL = anonymous memory */
+	char *dir;
+
+	/* bytes allocated in each category, until the reset */
+	size_t charged[MEM_CATEGORIES];
+};
+
+static void release_charges(struct arena *arena)
+{
+	for (int i = 0; i < MEM_CATEGORIES; ++i) {
+		mem_release(i, arena->charged[i]);
+		arena->charged[i] = 0;
+	}
+}
+
+/* an unlinked file of the size, -1 on failure */
+static int open_spill_file(const char *dir, size_t size)
+{
+	size_t len = strlen(dir) + sizeof("/jpeg-XXXXXX");
+	char *path = malloc(len);
+
+	if (path == NULL) {
+		return -1;
+	}
+
+	snprintf(path, len, "%s/jpeg-XXXXXX", dir);
+
+	int fd = mkstemp(path);
+
+	if (fd < 0) {
+		msg_error("cannot create a spill file in %s: %s\n", dir, strerror(errno));
+	} else {
+		unlink(path);
+
+		/* allocate the blocks now, rather than faulting on a full disk later */
+		int err = posix_fallocate(fd, 0, (off_t)size);
+
+		/* the error is returned, errno is not set */
+		if (err != 0) {
+			msg_error("cannot allocate %zu bytes of a spill file in %s: %s\n", size, dir, strerror(err));
+			close(fd);
+			fd = -1;
+		}
+	}
+
+	free(path);
+
+	return fd;
+}
+
+static struct chunk *chunk_map(const struct arena *arena, size_t size)
+{
+	/* the header occupies the first cache line */
+	size = arena_size(sizeof(struct chunk)) + size;
+
+	if (size < ARENA_CHUNK) {
+		size = ARENA_CHUNK;
+	}
+
+	void *map;
+
+	if (arena->dir != NULL) {
+		int fd = open_spill_file(arena->dir, size);
+
+		if (fd < 0) {
+			return NULL;
+		}
+
+		map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+		close(fd);
+
+		if (map == MAP_FAILED) {
+			return NULL;
+		}
+
+		/* the buffers are mostly swept in order, allow early write-back and eviction */
+		madvise(map, size, MADV_SEQUENTIAL);
+	} else {
+		map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (map == MAP_FAILED) {
+			return NULL;
+		}
+
+#ifdef MADV_HUGEPAGE
+		if (size >= ARENA_HUGE_PAGE) {
+			/* fewer TLB misses on the large buffers, merely a hint */
+			madvise(map, size, MADV_HUGEPAGE);
+		}
+#endif
+	}
+
+	struct chunk *chunk = map;
+
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = arena_size(sizeof(struct chunk));
+	chunk->clean = chunk->used;
+
+	return chunk;
+}
+
+static void chunk_unmap(struct chunk *chunk)
+{
+	munmap(chunk, chunk->size);
+}
+
+int arena_create(struct arena **arena)
+{
+	assert(arena != NULL);
+
+	*arena = malloc(sizeof(struct arena));
+
+	if (*arena == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	(*arena)->chunk = NULL;
+	(*arena)->dir = NULL;
+
+	for (int i = 0; i < MEM_CATEGORIES; ++i) {
+		(*arena)->charged[i] = 0;
+	}
+
+	return RET_SUCCESS;
+}
+
+int arena_create_file(struct arena **arena, const char *dir)
+{
+	int err;
+
+	assert(dir != NULL);
+
+	err = arena_create(arena);
+	RETURN_IF(err);
+
+	(*arena)->dir = strdup(dir);
+
+	if ((*arena)->dir == NULL) {
+		arena_destroy(*arena);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	return RET_SUCCESS;
+}
+
+void arena_destroy(struct arena *arena)
+{
+	if (arena == NULL) {
+		return;
+	}
+
+	release_charges(arena);
+
+	while (arena->chunk != NULL) {
+		struct chunk *next = arena->chunk->next;
+
+		chunk_unmap(arena->chunk);
+
+		arena->chunk = next;
+	}
+
+	free(arena->dir);
+	free(arena);
+}
+
+int arena_reserve(struct arena *arena, size_t size)
+{
+	assert(arena != NULL);
+
+	struct chunk *chunk = arena->chunk;
+
+	if (chunk != NULL && chunk->size - chunk->used >= size) {
+		return RET_SUCCESS;
+	}
+
+	chunk = chunk_map(arena, size);
+
+	if (chunk == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	chunk->next = arena->chunk;
+	arena->chunk = chunk;
+
+	return RET_SUCCESS;
+}
+
+void *arena_alloc(struct arena *arena, int category, size_t size)
+{
+	assert(arena != NULL);
+
+	size = arena_size(size);
+
+	if (arena_reserve(arena, size)) {
+		return NULL;
+	}
+
+	if (mem_charge(category, size)) {
+		return NULL;
+	}
+
+	arena->charged[category] += size;
+
+	struct chunk *chunk = arena->chunk;
+
+	void *ptr = (uint8_t *)chunk + chunk->used;
+
+	chunk->used += size;
+
+	return ptr;
+}
+
+void *arena_calloc(struct arena *arena, int category, size_t size)
+{
+	assert(arena != NULL);
+
+	uint8_t *ptr = arena_alloc(arena, category, size);
+
+	if (ptr == NULL) {
+		return NULL;
+	}
+
+	/* only the memory used before the reset, the fresh pages are not touched */
+	struct chunk *chunk = arena->chunk;
+	size_t offset = (size_t)(ptr - (uint8_t *)chunk);
+
+	if (offset < chunk->clean) {
+		memset(ptr, 0, (chunk->clean - offset < size) ? chunk->clean - offset : size);
+	}
+
+	return ptr;
+}
+
+void arena_reset(struct arena *arena)
+{
+	assert(arena != NULL);
+
+	release_charges(arena);
+
+	struct chunk *largest = NULL;
+
+	while (arena->chunk != NULL) {
+		struct chunk *chunk = arena->chunk;
+
+		arena->chunk = chunk->next;
+
+		if (largest == NULL || chunk->size > largest->size) {
+			if (largest != NULL) {
+				chunk_unmap(largest);
+			}
+			largest = chunk;
+		} else {
+			chunk_unmap(chunk);
+		}
+	}
+
+	if (largest != NULL) {
+		largest->next = NULL;
+		if (largest->clean < largest->used) {
+			largest->clean = largest->used;
+		}
+		largest->used = arena_size(sizeof(struct chunk));
+	}
+
+	arena->chunk = largest;
+}
@@ -0,0 +1,45 @@
+#ifndef JPEG_ARENA_H
+#define JPEG_ARENA_H
+
+#include <stddef.h>
+
+/* alignment of the allocations, one cache line (and any SIMD register) */
+#define ARENA_ALIGN 64
+
+/*
+ * Bump allocator for the image buffers.
+ *
+ * The memory is mapped in chunks, chunks of huge-page size and above are
+ * advised to be backed by huge pages. The allocations are not released
+ * individually, arena_reset() releases all of them at once while keeping
+ * the largest chunk mapped for the next image. An arena must not be used
+ * by two threads at once.
+ */
+struct arena;
+
+int arena_create(struct arena **arena);
+
+/* the memory is backed by unlinked temporary files in the directory, for the images larger than RAM */
+int arena_create_file(struct arena **arena, const char *dir);
+
+void arena_destroy(struct arena *arena);
+
+/* make sure the next allocations of size bytes in total fit in one chunk */
+int arena_reserve(struct arena *arena, size_t size);
+
+/* aligned to ARENA_ALIGN and charged to the MEM_* category, NULL on failure */
+void *arena_alloc(struct arena *arena, int category, size_t size);
+
+/* zero-filled arena_alloc() */
+void *arena_calloc(struct arena *arena, int category, size_t size);
+
+/* release all the allocations (and their charges) */
+void arena_reset(struct arena *arena);
+
+/* the size rounded up to ARENA_ALIGN */
+static inline size_t arena_size(size_t size)
+{
+	return (size + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+#endif
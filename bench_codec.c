@@ -0,0 +1,323 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <assert.h>
+#include <unistd.h>
+#include "jpeg.h"
+
+/*
+ * End-to-end benchmark over a synthetic corpus.
+ *
+ * Each image of the corpus is encoded and decoded through the library
+ * interface, the best time of the repetitions is kept. One JSON object is
+ * printed per configuration. The throughput is given in the uncompressed
+ * bytes (and pixels) for both the encoder and the decoder.
+ */
+
+enum {
+	PATTERN_GRADIENT,
+	PATTERN_NOISE,
+	PATTERN_TEXTURE,
+	PATTERNS
+};
+
+static const char *const pattern_to_str[PATTERNS] = {
+	[PATTERN_GRADIENT] = "gradient",
+	[PATTERN_NOISE] = "noise",
+	[PATTERN_TEXTURE] = "texture"
+};
+
+static const struct {
+	uint16_t width, height;
+} resolutions[] = {
+	{ 256, 256 },
+	{ 1024, 768 },
+	{ 1920, 1080 }
+};
+
+/* luma subsampling factors */
+static const struct {
+	const char *name;
+	uint8_t h, v;
+} samplings[] = {
+	{ "444", 1, 1 },
+	{ "422", 2, 1 },
+	{ "420", 2, 2 }
+};
+
+static const uint8_t precisions[] = { 8, 12 };
+
+/* restart interval in MCUs, 0 = none */
+static const uint16_t restarts[] = { 0, 16 };
+
+/* the same corpus on every run */
+static uint64_t xorshift64(uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+
+	return *state = x;
+}
+
+/* uniform in [0, 1) */
+static double uniform(uint64_t *state)
+{
+	return (double)(xorshift64(state) >> 11) * 0x1p-53;
+}
+
+static double clamp01(double x)
+{
+	return x < 0. ? 0. : (x > 1. ? 1. : x);
+}
+
+/* the sample of the component c at (x, y), in [0, 1] */
+static double pattern_sample(int pattern, const double *phase, uint64_t *state, double x, double y, int c)
+{
+	if (pattern == PATTERN_GRADIENT) {
+		/* a diagonal ramp, a different direction for each component */
+		return clamp01(c == 0 ? (x + y) / 2 : (c == 1 ? x : 1 - y));
+	}
+
+	if (pattern == PATTERN_NOISE) {
+		return uniform(state);
+	}
+
+	/* smooth shading, a finer texture, hard edges, and the sensor noise */
+	double v = .5
+		+ .25 * sin(2 * M_PI * (1.3 * x + .7 * y) + phase[c])
+		+ .12 * sin(2 * M_PI * (7.9 * x - 5.3 * y) + phase[3 + c])
+		+ .05 * sin(2 * M_PI * (41. * x + 37. * y) + phase[6 + c]);
+
+	if (((int)(x * 6) + (int)(y * 4)) % 5 == 0) {
+		v = 1 - v;
+	}
+
+	return clamp01(v + .02 * (uniform(state) - .5));
+}
+
+static int generate(struct jpeg_image *image, int pattern, uint16_t width, uint16_t height, uint8_t precision)
+{
+	size_t sample_size = precision > 8 ? 2 : 1;
+	size_t count = (size_t)width * height * 3;
+	uint8_t *data = malloc(sample_size * count);
+
+	if (data == NULL) {
+		return -1;
+	}
+
+	uint64_t state = UINT64_C(0x9e3779b97f4a7c15) + (uint64_t)pattern;
+	double phase[9];
+
+	for (int i = 0; i < 9; ++i) {
+		phase[i] = 2 * M_PI * uniform(&state);
+	}
+
+	unsigned maxval = (1U << precision) - 1;
+
+	for (size_t y = 0; y < height; ++y) {
+		for (size_t x = 0; x < width; ++x) {
+			for (int c = 0; c < 3; ++c) {
+				double v = pattern_sample(pattern, phase, &state, (double)x / width, (double)y / height, c);
+				unsigned s = (unsigned)lrint(v * maxval);
+				size_t i = (y * width + x) * 3 + c;
+
+				if (sample_size == 1) {
+					data[i] = (uint8_t)s;
+				} else {
+					data[2 * i + 0] = (uint8_t)(s >> 8);
+					data[2 * i + 1] = (uint8_t)s;
+				}
+			}
+		}
+	}
+
+	image->width = width;
+	image->height = height;
+	image->components = 3;
+	image->precision = precision;
+	image->data = data;
+	image->buffer = data;
+
+	return 0;
+}
+
+static double psnr(const struct jpeg_image *a, const struct jpeg_image *b)
+{
+	size_t count = (size_t)a->width * a->height * a->components;
+	const uint8_t *p = a->data;
+	const uint8_t *q = b->data;
+	double sum = 0.;
+
+	for (size_t i = 0; i < count; ++i) {
+		double d;
+
+		if (a->precision > 8) {
+			d = (double)((p[2 * i] << 8) | p[2 * i + 1]) - (double)((q[2 * i] << 8) | q[2 * i + 1]);
+		} else {
+			d = (double)p[i] - (double)q[i];
+		}
+
+		sum += d * d;
+	}
+
+	double maxval = (double)((1U << a->precision) - 1);
+
+	if (sum == 0.) {
+		return INFINITY;
+	}
+
+	return 10. * log10(maxval * maxval * (double)count / sum);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+struct result {
+	size_t size;
+	double encode_time;
+	double decode_time;
+	double psnr;
+};
+
+static int run(const struct jpeg_image *image, const struct jpeg_params *params, int repetitions, struct result *result)
+{
+	result->encode_time = INFINITY;
+	result->decode_time = INFINITY;
+
+	for (int r = 0; r < repetitions; ++r) {
+		void *out = NULL;
+		size_t size = 0;
+
+		double t0 = now();
+
+		if (jpeg_encode(image, params, &out, &size)) {
+			return -1;
+		}
+
+		double t1 = now();
+
+		struct jpeg_image decoded;
+
+		if (jpeg_decode(out, size, params, &decoded)) {
+			free(out);
+			return -1;
+		}
+
+		double t2 = now();
+
+		if (t1 - t0 < result->encode_time) {
+			result->encode_time = t1 - t0;
+		}
+		if (t2 - t1 < result->decode_time) {
+			result->decode_time = t2 - t1;
+		}
+
+		result->size = size;
+		result->psnr = psnr(image, &decoded);
+
+		jpeg_free_image(&decoded);
+		free(out);
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct jpeg_params params;
+
+	jpeg_init_params(&params);
+
+	int repetitions = 3;
+
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:j:q:")) != -1) {
+		switch (opt) {
+			case 'n':
+				repetitions = atoi(optarg);
+				break;
+			case 'j':
+				params.threads = atoi(optarg);
+				break;
+			case 'q':
+				params.quality = atoi(optarg);
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-n repetitions] [-j threads] [-q quality]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	if (repetitions < 1) {
+		repetitions = 1;
+	}
+
+	if (jpeg_arena_create(&params.arena)) {
+		return 1;
+	}
+
+	int failures = 0;
+
+	for (size_t s = 0; s < sizeof(resolutions) / sizeof(*resolutions); ++s) {
+		for (int p = 0; p < PATTERNS; ++p) {
+			for (size_t b = 0; b < sizeof(precisions); ++b) {
+				struct jpeg_image image;
+
+				if (generate(&image, p, resolutions[s].width, resolutions[s].height, precisions[b])) {
+					return 1;
+				}
+
+				double pixels = (double)image.width * image.height;
+				double bytes = pixels * 3 * (image.precision > 8 ? 2 : 1);
+
+				for (size_t m = 0; m < sizeof(samplings) / sizeof(*samplings); ++m) {
+					for (size_t r = 0; r < sizeof(restarts) / sizeof(*restarts); ++r) {
+						params.h = samplings[m].h;
+						params.v = samplings[m].v;
+						params.restart = restarts[r];
+
+						printf("{\"pattern\":\"%s\",\"width\":%" PRIu16 ",\"height\":%" PRIu16 ",\"sampling\":\"%s\",\"precision\":%" PRIu8 ",\"restart\":%" PRIu16 ",\"quality\":%i,\"threads\":%i,",
+							pattern_to_str[p], image.width, image.height, samplings[m].name, image.precision, params.restart, params.quality, params.threads);
+
+						struct result result;
+
+						if (run(&image, &params, repetitions, &result)) {
+							printf("\"error\":true}\n");
+							failures++;
+							continue;
+						}
+
+						printf("\"size\":%zu,\"bpp\":%.4f,\"psnr\":%.3f,"
+							"\"encode_mpix_s\":%.3f,\"encode_mb_s\":%.3f,\"decode_mpix_s\":%.3f,\"decode_mb_s\":%.3f}\n",
+							result.size, 8. * (double)result.size / pixels, isinf(result.psnr) ? 999. : result.psnr,
+							pixels * 1e-6 / result.encode_time, bytes * 1e-6 / result.encode_time,
+							pixels * 1e-6 / result.decode_time, bytes * 1e-6 / result.decode_time);
+
+						fflush(stdout);
+					}
+				}
+
+				free(image.buffer);
+			}
+		}
+	}
+
+	jpeg_arena_destroy(params.arena);
+
+	return failures != 0;
+}
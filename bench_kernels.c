@@ -0,0 +1,754 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <assert.h>
+#include <unistd.h>
+#ifdef __linux__
+#	include <sys/ioctl.h>
+#	include <sys/syscall.h>
+#	include <linux/perf_event.h>
+#endif
+#include "common.h"
+#include "coeffs.h"
+#include "huffman.h"
+#include "imgproc.h"
+#include "kernels.h"
+#include "encode.h"
+#include "source.h"
+#include "io.h"
+
+/*
+ * Microbenchmarks of the individual kernels.
+ *
+ * Every kernel runs over the same fixed input: a textured luma plane cut
+ * into 8x8 blocks, transformed and quantized at the given quality, and
+ * entropy-coded with the optimized Huffman tables (K.2). One pass of a kernel
+ * visits all the items (blocks, symbols, or pixels); the fastest pass of
+ * the repetitions is reported as a JSON line.
+ *
+ * The hardware counters come from perf_event_open(2), user space only.
+ * They are null when not available (other systems, perf_event_paranoid,
+ * containers). The bytes of cycles_per_byte are the compressed bytes for
+ * the entropy-coding kernels, and the uncompressed samples otherwise.
+ */
+
+/* the plane, 4096 blocks */
+#define WIDTH 512
+#define HEIGHT 512
+#define BLOCKS ((WIDTH / 8) * (HEIGHT / 8))
+
+/* the lines of the color kernels */
+#define LINE 1920
+#define LINES 64
+
+enum {
+	COUNTER_CYCLES,
+	COUNTER_INSTRUCTIONS,
+	COUNTER_CACHE_MISSES,
+	COUNTER_BRANCH_MISSES,
+	COUNTERS
+};
+
+struct counters {
+	/* -1 = not available, fd[COUNTER_CYCLES] leads the group */
+	int fd[COUNTERS];
+	uint64_t value[COUNTERS];
+};
+
+#ifdef __linux__
+static int perf_open(uint64_t config, int group_fd)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.disabled = group_fd == -1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+static void counters_open(struct counters *counters)
+{
+	for (int i = 0; i < COUNTERS; ++i) {
+		counters->fd[i] = -1;
+	}
+
+#ifdef __linux__
+	static const uint64_t config[COUNTERS] = {
+		[COUNTER_CYCLES] = PERF_COUNT_HW_CPU_CYCLES,
+		[COUNTER_INSTRUCTIONS] = PERF_COUNT_HW_INSTRUCTIONS,
+		[COUNTER_CACHE_MISSES] = PERF_COUNT_HW_CACHE_MISSES,
+		[COUNTER_BRANCH_MISSES] = PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	counters->fd[COUNTER_CYCLES] = perf_open(config[COUNTER_CYCLES], -1);
+
+	if (counters->fd[COUNTER_CYCLES] == -1) {
+		return;
+	}
+
+	/* a missing member does not disable the others */
+	for (int i = 1; i < COUNTERS; ++i) {
+		counters->fd[i] = perf_open(config[i], counters->fd[COUNTER_CYCLES]);
+	}
+#endif
+}
+
+static void counters_close(struct counters *counters)
+{
+	for (int i = 0; i < COUNTERS; ++i) {
+		if (counters->fd[i] != -1) {
+			close(counters->fd[i]);
+		}
+	}
+}
+
+static void counters_start(struct counters *counters)
+{
+#ifdef __linux__
+	int leader = counters->fd[COUNTER_CYCLES];
+
+	if (leader != -1) {
+		ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+#else
+	(void)counters;
+#endif
+}
+
+static void counters_stop(struct counters *counters)
+{
+#ifdef __linux__
+	int leader = counters->fd[COUNTER_CYCLES];
+
+	if (leader != -1) {
+		ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	}
+#endif
+
+	for (int i = 0; i < COUNTERS; ++i) {
+		if (counters->fd[i] == -1 || read(counters->fd[i], &counters->value[i], sizeof(uint64_t)) != sizeof(uint64_t)) {
+			counters->value[i] = 0;
+		}
+	}
+}
+
+/* the fixed input of the kernels */
+struct input {
+	uint8_t P;
+	const struct kernels *kernels;
+
+	struct qtable qtable;
+
+	/* samples in [0, 2^P - 1], in 8x8 blocks */
+	struct flt_block *samples;
+	/* quantized coefficients */
+	struct int_block *coeffs;
+	/* dequantized coefficients */
+	struct flt_block *dct;
+
+	/* work buffers */
+	struct flt_block *flt;
+	struct int_block *ints;
+	struct token *token;
+
+	/* the entropy-coded blocks, DC differences from zero */
+	uint8_t *ecs;
+	size_t ecs_size;
+
+	/* the AC symbols alone, and their codes */
+	uint8_t *symbol;
+	size_t symbols;
+	uint8_t *codes;
+	size_t codes_size;
+
+	/* interleaved RGB lines, and the PNM samples */
+	float *rgb;
+	float *line;
+	uint8_t *pnm;
+
+	/* the buffer of the write kernels */
+	uint8_t *out;
+	size_t out_size;
+
+	/* the context of the entropy coding, one component */
+	struct context context;
+};
+
+/* the same input on every run */
+static uint64_t xorshift64(uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+
+	return *state = x;
+}
+
+static double uniform(uint64_t *state)
+{
+	return (double)(xorshift64(state) >> 11) * 0x1p-53;
+}
+
+/* smooth shading, a finer texture, hard edges, and the sensor noise, in [0, 1] */
+static double texture(uint64_t *state, double x, double y, int c)
+{
+	double v = .5
+		+ .25 * sin(2 * M_PI * (1.3 * x + .7 * y) + c)
+		+ .12 * sin(2 * M_PI * (7.9 * x - 5.3 * y) + 2 * c)
+		+ .05 * sin(2 * M_PI * (41. * x + 37. * y) + 3 * c);
+
+	if (((int)(x * 6) + (int)(y * 4)) % 5 == 0) {
+		v = 1 - v;
+	}
+
+	v += .02 * (uniform(state) - .5);
+
+	return v < 0. ? 0. : (v > 1. ? 1. : v);
+}
+
+/* write the symbols (or the blocks when symbol is NULL) into the buffer */
+static int encode_input(struct input *input, const uint8_t *symbol, uint8_t **data, size_t *size)
+{
+	char *buffer = NULL;
+	size_t buffer_size = 0;
+	FILE *stream = open_memstream(&buffer, &buffer_size);
+
+	if (stream == NULL) {
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	struct bits bits;
+	int err = init_bits(&bits, stream);
+
+	for (size_t i = 0; !err && i < (symbol != NULL ? input->symbols : BLOCKS); ++i) {
+		if (symbol != NULL) {
+			err = write_code(&bits, &input->context.hcode[1][0], symbol[i]);
+		} else {
+			err = write_block(&bits, &input->context, 0, &input->coeffs[i]);
+		}
+	}
+
+	if (!err) {
+		err = flush_bits(&bits);
+	}
+
+	if (fclose(stream) == EOF && !err) {
+		err = RET_FAILURE_FILE_IO;
+	}
+
+	if (err) {
+		free(buffer);
+		return err;
+	}
+
+	*data = (uint8_t *)buffer;
+	*size = buffer_size;
+
+	return RET_SUCCESS;
+}
+
+static int init_input(struct input *input, uint8_t P, int q)
+{
+	memset(input, 0, sizeof(*input));
+
+	input->P = P;
+	input->kernels = select_kernels(P);
+
+	set_std_qtable(&input->qtable, 0, q);
+
+	input->samples = malloc(BLOCKS * sizeof(struct flt_block));
+	input->coeffs = malloc(BLOCKS * sizeof(struct int_block));
+	input->dct = malloc(BLOCKS * sizeof(struct flt_block));
+	input->flt = malloc(BLOCKS * sizeof(struct flt_block));
+	input->ints = malloc(BLOCKS * sizeof(struct int_block));
+	input->token = malloc(BLOCKS * MAX_BLOCK_TOKENS * sizeof(struct token));
+	input->symbol = malloc(BLOCKS * 63);
+	input->rgb = malloc(LINES * LINE * 3 * sizeof(float));
+	input->line = malloc(LINE * 3 * sizeof(float));
+	input->pnm = malloc(LINES * LINE * 3 * 2);
+
+	if (input->samples == NULL || input->coeffs == NULL || input->dct == NULL || input->flt == NULL || input->ints == NULL
+	 || input->token == NULL || input->symbol == NULL || input->rgb == NULL || input->line == NULL || input->pnm == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	uint64_t state = UINT64_C(0x9e3779b97f4a7c15);
+	double maxval = (double)((1U << P) - 1);
+
+	for (size_t b = 0; b < BLOCKS; ++b) {
+		size_t block_x = b % (WIDTH / 8);
+		size_t block_y = b / (WIDTH / 8);
+
+		for (int i = 0; i < 64; ++i) {
+			double x = (double)(block_x * 8 + i % 8) / WIDTH;
+			double y = (double)(block_y * 8 + i / 8) / HEIGHT;
+
+			input->samples[b].c[i] = (float)lrint(texture(&state, x, y, 0) * maxval);
+		}
+
+		struct flt_block flt_block = input->samples[b];
+
+		input->kernels->forward_dct_block(&flt_block, P);
+		quantize_block(&input->coeffs[b], &flt_block, &input->qtable);
+		dequantize_block(&input->coeffs[b], &input->dct[b], &input->qtable);
+	}
+
+	for (size_t y = 0; y < LINES; ++y) {
+		for (size_t x = 0; x < LINE; ++x) {
+			for (int c = 0; c < 3; ++c) {
+				input->rgb[(y * LINE + x) * 3 + c] = (float)lrint(texture(&state, (double)x / LINE, (double)y / LINES, c) * maxval);
+			}
+		}
+	}
+
+	/* the PNM samples of the same lines, for unpack_line */
+	size_t stride = LINE * 3 * (P > 8 ? 2 : 1);
+
+	for (size_t y = 0; y < LINES; ++y) {
+		input->kernels->pack_line(&input->rgb[y * LINE * 3], &input->pnm[y * stride], LINE, 3, 3, P);
+	}
+
+	int err = init_context(&input->context);
+	RETURN_IF(err);
+
+	err = alloc_components(&input->context, 1);
+	RETURN_IF(err);
+
+	input->context.P = P;
+
+	/* the AC symbols of the blocks, and the Huffman tables adapted to them */
+	struct huffenc huffenc_dc, huffenc_ac;
+
+	init_huffenc(&huffenc_dc);
+	init_huffenc(&huffenc_ac);
+
+	for (size_t b = 0; b < BLOCKS; ++b) {
+		struct token token[MAX_BLOCK_TOKENS];
+		size_t n = tokenize_block(input->kernels, &input->coeffs[b], 0, &huffenc_dc, &huffenc_ac, token);
+
+		for (size_t k = 1; k < n; ++k) {
+			input->symbol[input->symbols++] = token[k].value;
+		}
+	}
+
+	/* the default tables do not cover the categories of 12-bit samples */
+	err = adapt_huffman_table(&input->context.htable[0][0], &huffenc_dc, HUFFMAN_ANNEX_K);
+	RETURN_IF(err);
+
+	err = conv_htable_to_hcode(&input->context.htable[0][0], &input->context.hcode[0][0]);
+	RETURN_IF(err);
+
+	err = adapt_huffman_table(&input->context.htable[1][0], &huffenc_ac, HUFFMAN_ANNEX_K);
+	RETURN_IF(err);
+
+	err = conv_htable_to_hcode(&input->context.htable[1][0], &input->context.hcode[1][0]);
+	RETURN_IF(err);
+
+	err = encode_input(input, NULL, &input->ecs, &input->ecs_size);
+	RETURN_IF(err);
+
+	err = encode_input(input, input->symbol, &input->codes, &input->codes_size);
+	RETURN_IF(err);
+
+	/* with a margin for the byte stuffing */
+	input->out_size = 2 * input->ecs_size + 4096;
+	input->out = malloc(input->out_size);
+
+	if (input->out == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	return RET_SUCCESS;
+}
+
+static void free_input(struct input *input)
+{
+	free(input->samples);
+	free(input->coeffs);
+	free(input->dct);
+	free(input->flt);
+	free(input->ints);
+	free(input->token);
+	free(input->symbol);
+	free(input->codes);
+	free(input->ecs);
+	free(input->rgb);
+	free(input->line);
+	free(input->pnm);
+	free(input->out);
+
+	free_buffers(&input->context);
+}
+
+static int pass_read_code(struct input *input)
+{
+	struct source source;
+	struct bits bits;
+
+	source_init_memory(&source, input->codes, input->codes_size);
+	init_bits_source(&bits, &source);
+
+	for (size_t i = 0; i < input->symbols; ++i) {
+		uint8_t value;
+		int err = read_code(&bits, &input->context.hcode[1][0], &value);
+		RETURN_IF(err);
+
+		if (value != input->symbol[i]) {
+			return RET_FAILURE_LOGIC_ERROR;
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+static int pass_read_block(struct input *input)
+{
+	struct source source;
+	struct bits bits;
+
+	source_init_memory(&source, input->ecs, input->ecs_size);
+	init_bits_source(&bits, &source);
+
+	for (size_t b = 0; b < BLOCKS; ++b) {
+		int err = read_block(&bits, &input->context, 0, &input->ints[b]);
+		RETURN_IF(err);
+	}
+
+	return RET_SUCCESS;
+}
+
+static int pass_write_block(struct input *input)
+{
+	FILE *stream = fmemopen(input->out, input->out_size, "w");
+
+	if (stream == NULL) {
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	struct bits bits;
+	int err = init_bits(&bits, stream);
+
+	for (size_t b = 0; !err && b < BLOCKS; ++b) {
+		err = write_block(&bits, &input->context, 0, &input->coeffs[b]);
+	}
+
+	if (!err) {
+		err = flush_bits(&bits);
+	}
+
+	if (fclose(stream) == EOF && !err) {
+		err = RET_FAILURE_FILE_IO;
+	}
+
+	return err;
+}
+
+static int pass_tokenize_block(struct input *input)
+{
+	struct huffenc huffenc_dc, huffenc_ac;
+
+	init_huffenc(&huffenc_dc);
+	init_huffenc(&huffenc_ac);
+
+	int32_t pred = 0;
+
+	for (size_t b = 0; b < BLOCKS; ++b) {
+		tokenize_block(input->kernels, &input->coeffs[b], pred, &huffenc_dc, &huffenc_ac, &input->token[b * MAX_BLOCK_TOKENS]);
+
+		pred = input->coeffs[b].c[0];
+	}
+
+	return RET_SUCCESS;
+}
+
+static int pass_inverse_dct(struct input *input)
+{
+	memcpy(input->flt, input->dct, BLOCKS * sizeof(struct flt_block));
+
+	for (size_t b = 0; b < BLOCKS; ++b) {
+		input->kernels->inverse_dct_block(&input->flt[b], input->P);
+	}
+
+	return RET_SUCCESS;
+}
+
+static int pass_forward_dct(struct input *input)
+{
+	memcpy(input->flt, input->samples, BLOCKS * sizeof(struct flt_block));
+
+	for (size_t b = 0; b < BLOCKS; ++b) {
+		input->kernels->forward_dct_block(&input->flt[b], input->P);
+	}
+
+	return RET_SUCCESS;
+}
+
+static int pass_dequantize_block(struct input *input)
+{
+	for (size_t b = 0; b < BLOCKS; ++b) {
+		dequantize_block(&input->coeffs[b], &input->flt[b], &input->qtable);
+	}
+
+	return RET_SUCCESS;
+}
+
+static int pass_quantize_block(struct input *input)
+{
+	for (size_t b = 0; b < BLOCKS; ++b) {
+		quantize_block(&input->ints[b], &input->dct[b], &input->qtable);
+	}
+
+	return RET_SUCCESS;
+}
+
+/* the color kernels work in place, the line is restored from the input */
+static int pass_ycc_to_rgb(struct input *input)
+{
+	for (size_t y = 0; y < LINES; ++y) {
+		memcpy(input->line, &input->rgb[y * LINE * 3], LINE * 3 * sizeof(float));
+
+		input->kernels->ycc_to_rgb_line(input->line, LINE, input->P);
+	}
+
+	return RET_SUCCESS;
+}
+
+static int pass_rgb_to_ycc(struct input *input)
+{
+	for (size_t y = 0; y < LINES; ++y) {
+		memcpy(input->line, &input->rgb[y * LINE * 3], LINE * 3 * sizeof(float));
+
+		input->kernels->rgb_to_ycc_line(input->line, LINE, input->P);
+	}
+
+	return RET_SUCCESS;
+}
+
+static int pass_pack_line(struct input *input)
+{
+	size_t stride = LINE * 3 * (input->P > 8 ? 2 : 1);
+
+	for (size_t y = 0; y < LINES; ++y) {
+		input->kernels->pack_line(&input->rgb[y * LINE * 3], &input->pnm[y * stride], LINE, 3, 3, input->P);
+	}
+
+	return RET_SUCCESS;
+}
+
+static int pass_unpack_line(struct input *input)
+{
+	size_t stride = LINE * 3 * (input->P > 8 ? 2 : 1);
+
+	for (size_t y = 0; y < LINES; ++y) {
+		input->kernels->unpack_line(&input->pnm[y * stride], input->line, LINE, 3, input->P);
+	}
+
+	return RET_SUCCESS;
+}
+
+enum {
+	UNIT_BLOCK,
+	UNIT_SYMBOL,
+	UNIT_PIXEL
+};
+
+static const char *const unit_to_str[] = {
+	[UNIT_BLOCK] = "block",
+	[UNIT_SYMBOL] = "symbol",
+	[UNIT_PIXEL] = "pixel"
+};
+
+static const struct {
+	const char *name;
+	int (*pass)(struct input *input);
+	int unit;
+	/* the bytes are the entropy-coded data */
+	int compressed;
+} benches[] = {
+	{ "read_code", pass_read_code, UNIT_SYMBOL, 1 },
+	{ "read_block", pass_read_block, UNIT_BLOCK, 1 },
+	{ "write_block", pass_write_block, UNIT_BLOCK, 1 },
+	{ "tokenize_block", pass_tokenize_block, UNIT_BLOCK, 1 },
+	{ "inverse_dct_block", pass_inverse_dct, UNIT_BLOCK, 0 },
+	{ "forward_dct_block", pass_forward_dct, UNIT_BLOCK, 0 },
+	{ "dequantize_block", pass_dequantize_block, UNIT_BLOCK, 0 },
+	{ "quantize_block", pass_quantize_block, UNIT_BLOCK, 0 },
+	{ "ycc_to_rgb_line", pass_ycc_to_rgb, UNIT_PIXEL, 0 },
+	{ "rgb_to_ycc_line", pass_rgb_to_ycc, UNIT_PIXEL, 0 },
+	{ "pack_line", pass_pack_line, UNIT_PIXEL, 0 },
+	{ "unpack_line", pass_unpack_line, UNIT_PIXEL, 0 }
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+static void print_ratio(const char *name, const struct counters *counters, int counter, double denominator)
+{
+	if (counters->fd[counter] == -1) {
+		printf(",\"%s\":null", name);
+	} else {
+		printf(",\"%s\":%.4f", name, (double)counters->value[counter] / denominator);
+	}
+}
+
+static int run(struct input *input, size_t i, int repetitions, struct counters *counters)
+{
+	size_t items;
+	double bytes;
+	size_t sample_size = input->P > 8 ? 2 : 1;
+
+	switch (benches[i].unit) {
+		case UNIT_SYMBOL:
+			items = input->symbols;
+			break;
+		case UNIT_BLOCK:
+			items = BLOCKS;
+			break;
+		default:
+			items = LINES * LINE;
+	}
+
+	if (benches[i].compressed) {
+		bytes = (double)(benches[i].unit == UNIT_SYMBOL ? input->codes_size : input->ecs_size);
+	} else {
+		bytes = (double)(items * sample_size * (benches[i].unit == UNIT_PIXEL ? 3 : 64));
+	}
+
+	uint64_t best = UINT64_MAX;
+	uint64_t value[COUNTERS] = { 0 };
+
+	/* one warm-up pass */
+	for (int r = -1; r < repetitions; ++r) {
+		uint64_t t0 = now_ns();
+		counters_start(counters);
+
+		int err = benches[i].pass(input);
+
+		counters_stop(counters);
+		uint64_t t1 = now_ns();
+
+		RETURN_IF(err);
+
+		if (r >= 0 && t1 - t0 < best) {
+			best = t1 - t0;
+			memcpy(value, counters->value, sizeof(value));
+		}
+	}
+
+	memcpy(counters->value, value, sizeof(value));
+
+	printf("{\"kernel\":\"%s\",\"isa\":\"%s\",\"precision\":%" PRIu8 ",\"unit\":\"%s\",\"items\":%zu,\"bytes\":%.0f,\"ns_per_item\":%.3f",
+		benches[i].name, input->kernels->isa, input->P, unit_to_str[benches[i].unit], items, bytes, (double)best / (double)items);
+
+	print_ratio("cycles_per_byte", counters, COUNTER_CYCLES, bytes);
+
+	if (counters->fd[COUNTER_CYCLES] == -1 || counters->fd[COUNTER_INSTRUCTIONS] == -1 || value[COUNTER_CYCLES] == 0) {
+		printf(",\"ipc\":null");
+	} else {
+		printf(",\"ipc\":%.3f", (double)value[COUNTER_INSTRUCTIONS] / (double)value[COUNTER_CYCLES]);
+	}
+
+	print_ratio("cache_misses_per_item", counters, COUNTER_CACHE_MISSES, (double)items);
+	print_ratio("branch_misses_per_item", counters, COUNTER_BRANCH_MISSES, (double)items);
+
+	printf("}\n");
+
+	fflush(stdout);
+
+	return RET_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	uint8_t P = 8;
+	int repetitions = 10;
+	int q = 75;
+	const char *only = NULL;
+
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:n:q:k:")) != -1) {
+		switch (opt) {
+			case 'p':
+				P = (uint8_t)atoi(optarg);
+				break;
+			case 'n':
+				repetitions = atoi(optarg);
+				break;
+			case 'q':
+				q = atoi(optarg);
+				break;
+			case 'k':
+				only = optarg;
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-p precision] [-n repetitions] [-q quality] [-k kernel]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	if (P != 8 && P != 12) {
+		fprintf(stderr, "the precision must be 8 or 12\n");
+		return 1;
+	}
+
+	if (repetitions < 1) {
+		repetitions = 1;
+	}
+
+	msg_stream = stderr;
+
+	struct input input;
+
+	if (init_input(&input, P, q)) {
+		fprintf(stderr, "the input cannot be prepared\n");
+		free_input(&input);
+		return 1;
+	}
+
+	struct counters counters;
+
+	counters_open(&counters);
+
+	if (counters.fd[COUNTER_CYCLES] == -1) {
+		fprintf(stderr, "hardware counters not available, only the time is measured\n");
+	}
+
+	int failures = 0;
+
+	for (size_t i = 0; i < sizeof(benches) / sizeof(*benches); ++i) {
+		if (only != NULL && strcmp(only, benches[i].name) != 0) {
+			continue;
+		}
+
+		if (run(&input, i, repetitions, &counters)) {
+			printf("{\"kernel\":\"%s\",\"error\":true}\n", benches[i].name);
+			failures++;
+		}
+	}
+
+	counters_close(&counters);
+	free_input(&input);
+
+	return failures != 0;
+}
@@ -1,6 +1,10 @@
 #include <assert.h>
+#include <stdlib.h>
 #include "coeffs.h"
 #include "huffman.h"
+#include "arena.h"
+#include "mem.h"
+#include "analysis.h"
 
 struct coeff_dc {
 	int32_t c;
@@ -59,18 +63,9 @@ uint8_t encode_cat(int32_t c)
 		return 0;
 	}
 
-	if (c < 0) {
-		c = -c;
-	}
+	uint32_t m = (uint32_t)(c < 0 ? -c : c);
 
-	uint8_t r = 0;
-
-	do {
-		c >>= 1;
-		r++;
-	} while (c != 0);
-
-	return r;
+	return (uint8_t)(32 - __builtin_clz(m));
 }
 
 uint16_t encode_extra(int32_t c, uint8_t cat)
@@ -83,7 +78,7 @@ uint16_t encode_extra(int32_t c, uint8_t cat)
 }
 
 // read_code + read_extra_bits + compose the coefficient value
-int read_dc(struct bits *bits, struct hcode *hcode_dc, struct coeff_dc *coeff_dc)
+int read_dc(struct bits *bits, const struct hcode *hcode_dc, struct coeff_dc *coeff_dc)
 {
 	int err;
 
@@ -106,26 +101,7 @@ int read_dc(struct bits *bits, struct hcode *hcode_dc, struct coeff_dc *coeff_dc
 	return RET_SUCCESS;
 }
 
-// encode_cat(), encode_extra(), write_code(), write_extra_bits()
-int write_dc(struct bits *bits, struct hcode *hcode_dc, struct coeff_dc *coeff_dc)
-{
-	int err;
-
-	assert(coeff_dc != NULL);
-
-	uint8_t cat = encode_cat(coeff_dc->c);
-	uint16_t extra = encode_extra(coeff_dc->c, cat);
-
-	err = write_code(bits, hcode_dc, cat);
-	RETURN_IF(err);
-
-	err = write_extra_bits(bits, cat, extra);
-	RETURN_IF(err);
-
-	return RET_SUCCESS;
-}
-
-int read_ac(struct bits *bits, struct hcode *hcode_ac, struct coeff_ac *coeff_ac)
+int read_ac(struct bits *bits, const struct hcode *hcode_ac, struct coeff_ac *coeff_ac)
 {
 	int err;
 
@@ -160,37 +136,14 @@ int read_ac(struct bits *bits, struct hcode *hcode_ac, struct coeff_ac *coeff_ac
 	return RET_SUCCESS;
 }
 
-// encode_cat, encode_extra, compose rs from zrl and cat, write_code(), write_extra_bits()
-int write_ac(struct bits *bits, struct hcode *hcode_ac, struct coeff_ac *coeff_ac)
+/* the RS symbol read */
+static uint8_t coeff_ac_to_value(const struct coeff_ac *coeff_ac)
 {
-	int err;
-
-	assert(coeff_ac != NULL);
-
-	// due to valgrind
-	if (coeff_ac->eob) {
-		coeff_ac->c = 0;
-	}
-
-	uint8_t cat = encode_cat(coeff_ac->c);
-	uint16_t extra = encode_extra(coeff_ac->c, cat);
-
-	uint8_t rs = cat_zrl_to_value(cat, coeff_ac->zrl);
-
 	if (coeff_ac->eob) {
-		cat = 0; // no extra bits
-		rs = 0;
+		return 0x00;
 	}
 
-	// write Huff(rs), extra
-
-	err = write_code(bits, hcode_ac, rs);
-	RETURN_IF(err);
-
-	err = write_extra_bits(bits, cat, extra);
-	RETURN_IF(err);
-
-	return RET_SUCCESS;
+	return cat_zrl_to_value(encode_cat(coeff_ac->c), coeff_ac->zrl);
 }
 
 int read_block(struct bits *bits, struct context *context, uint8_t Cs, struct int_block *int_block)
@@ -199,8 +152,8 @@ int read_block(struct bits *bits, struct context *context, uint8_t Cs, struct in
 	uint8_t Td = context->component[Cs].Td;
 	uint8_t Ta = context->component[Cs].Ta;
 
-	struct hcode *hcode_dc = &context->hcode[0][Td];
-	struct hcode *hcode_ac = &context->hcode[1][Ta];
+	const struct hcode *hcode_dc = &context->hcode[0][Td];
+	const struct hcode *hcode_ac = &context->hcode[1][Ta];
 
 	struct coeff_dc coeff_dc;
 
@@ -213,12 +166,16 @@ int read_block(struct bits *bits, struct context *context, uint8_t Cs, struct in
 	 * the int_block to NULL... treat this as if there was no more data
 	 */
 	if (int_block == NULL) {
-		printf("*** corrupted JPEG file ***\n");
+		msg_warn("*** corrupted JPEG file ***\n");
 		return RET_FAILURE_NO_MORE_DATA;
 	}
 
 	assert(int_block != NULL);
 
+	if (context->analysis != NULL) {
+		analysis_dc(context->analysis, Cs, Td, hcode_dc, encode_cat(coeff_dc.c));
+	}
+
 	int_block->c[zigzag[0]] = coeff_dc.c;
 
 	// reset all remaining 63 coefficients to zero
@@ -237,6 +194,10 @@ int read_block(struct bits *bits, struct context *context, uint8_t Cs, struct in
 		err = read_ac(bits, hcode_ac, &coeff_ac);
 		RETURN_IF(err);
 
+		if (context->analysis != NULL) {
+			analysis_ac(context->analysis, Cs, Ta, hcode_ac, coeff_ac_to_value(&coeff_ac));
+		}
+
 		// EOB
 		if (coeff_ac.eob) {
 			break;
@@ -253,111 +214,387 @@ int read_block(struct bits *bits, struct context *context, uint8_t Cs, struct in
 	return RET_SUCCESS;
 }
 
-int write_block(struct bits *bits, struct context *context, uint8_t Cs, struct int_block *int_block)
+int alloc_sparse(struct context *context, struct component *component, size_t blocks)
+{
+	assert(context != NULL);
+	assert(component != NULL);
+
+	struct sparse *sparse = arena_alloc(context->arena, MEM_COEFFS, sizeof(struct sparse));
+
+	if (sparse == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	sparse->block = arena_calloc(context->arena, MEM_COEFFS, sizeof(uint64_t) * blocks);
+
+	if (sparse->block == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	sparse->blocks = blocks;
+	sparse->pair = NULL;
+	sparse->pairs = 0;
+	sparse->capacity = 0;
+
+	component->sparse = sparse;
+
+	return RET_SUCCESS;
+}
+
+/* the index and the store itself live in the arena */
+void free_sparse(struct sparse *sparse)
+{
+	if (sparse != NULL) {
+		mem_free(MEM_COEFFS, sparse->pair);
+	}
+}
+
+static int sparse_append(struct sparse *sparse, size_t block_seq, const struct coeff_pair *pair, size_t count)
+{
+	assert(sparse != NULL);
+	assert(block_seq < sparse->blocks);
+
+	if (sparse->pairs + count > sparse->capacity) {
+		size_t capacity = sparse->capacity * 2;
+
+		if (capacity < sparse->pairs + count + 4096) {
+			capacity = sparse->pairs + count + 4096;
+		}
+
+		struct coeff_pair *p = mem_realloc(MEM_COEFFS, sparse->pair, sizeof(struct coeff_pair) * capacity);
+
+		if (p == NULL) {
+			return RET_FAILURE_MEMORY_ALLOCATION;
+		}
+
+		sparse->pair = p;
+		sparse->capacity = capacity;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		sparse->pair[sparse->pairs + i] = pair[i];
+	}
+
+	sparse->block[block_seq] = (uint64_t)sparse->pairs << 7 | count;
+	sparse->pairs += count;
+
+	return RET_SUCCESS;
+}
+
+int read_block_sparse(struct bits *bits, struct context *context, uint8_t Cs, struct sparse *sparse, size_t block_seq, int32_t *pred)
 {
 	int err;
 	uint8_t Td = context->component[Cs].Td;
 	uint8_t Ta = context->component[Cs].Ta;
 
-	struct hcode *hcode_dc = &context->hcode[0][Td];
-	struct hcode *hcode_ac = &context->hcode[1][Ta];
+	const struct hcode *hcode_dc = &context->hcode[0][Td];
+	const struct hcode *hcode_ac = &context->hcode[1][Ta];
 
-	assert(int_block != NULL);
+	assert(pred != NULL);
 
 	struct coeff_dc coeff_dc;
 
-	coeff_dc.c = int_block->c[zigzag[0]];
-
-	// write_dc()
-	err = write_dc(bits, hcode_dc, &coeff_dc);
+	err = read_dc(bits, hcode_dc, &coeff_dc);
 	RETURN_IF(err);
 
-	/* Figure F.2 – Procedure for sequential encoding of AC coefficients with Huffman coding */
-	for (int r = 0, i = 1; i < 64; ++i) {
+	/* see read_block() */
+	if (sparse == NULL) {
+		msg_warn("*** corrupted JPEG file ***\n");
+		return RET_FAILURE_NO_MORE_DATA;
+	}
+
+	if (context->analysis != NULL) {
+		analysis_dc(context->analysis, Cs, Td, hcode_dc, encode_cat(coeff_dc.c));
+	}
+
+	struct coeff_pair pair[64];
+	size_t n = 0;
+
+	/* remove differential DC coding */
+	*pred += coeff_dc.c;
+
+	if (*pred != 0) {
+		pair[n].k = 0;
+		pair[n].c = (int16_t)*pred;
+		n++;
+	}
+
+	int i = 1;
+	int rem = 63;
+
+	do {
 		struct coeff_ac coeff_ac;
-		coeff_ac.eob = 0;
-
-		if (int_block->c[zigzag[i]] == 0) {
-			/* zero coefficient */
-			if (i == 63) {
-				coeff_ac.eob = 1;
-				err = write_ac(bits, hcode_ac, &coeff_ac);
-				RETURN_IF(err);
-			} else {
-				r++;
-			}
-		} else {
-			/* non-zero coefficient */
-			while (r > 15) {
-				/* produce ZRL */
-				coeff_ac.c = 0;
-				coeff_ac.zrl = 15;
-				err = write_ac(bits, hcode_ac, &coeff_ac);
-				RETURN_IF(err);
-				r -= 16;
-			}
-			/* encode coefficient */
-			coeff_ac.c = int_block->c[zigzag[i]];
-			coeff_ac.zrl = r;
-			err = write_ac(bits, hcode_ac, &coeff_ac);
-			RETURN_IF(err);
-			r = 0;
+
+		err = read_ac(bits, hcode_ac, &coeff_ac);
+
+		/* keep the coefficients read so far, as read_block() does */
+		if (err) {
+			sparse_append(sparse, block_seq, pair, n);
+			return err;
+		}
+
+		if (context->analysis != NULL) {
+			analysis_ac(context->analysis, Cs, Ta, hcode_ac, coeff_ac_to_value(&coeff_ac));
 		}
+
+		if (coeff_ac.eob) {
+			break;
+		}
+
+		i += coeff_ac.zrl;
+
+		/* ZRL codes no coefficient, as do the corrupted runs past the block */
+		if (coeff_ac.c != 0 && i < 64) {
+			pair[n].k = (uint8_t)i;
+			pair[n].c = (int16_t)coeff_ac.c;
+			n++;
+		}
+
+		i++;
+
+		rem -= coeff_ac.zrl + 1;
+	} while (rem > 0);
+
+	return sparse_append(sparse, block_seq, pair, n);
+}
+
+int32_t sparse_dc(const struct sparse *sparse, size_t block_seq)
+{
+	assert(sparse != NULL);
+
+	uint64_t block = sparse->block[block_seq];
+	const struct coeff_pair *pair = sparse->pair + (block >> 7);
+
+	if ((block & 127) != 0 && pair->k == 0) {
+		return pair->c;
 	}
 
-	return RET_SUCCESS;
+	return 0;
 }
 
-/* don't actually compress the block, just collect the coded values to later optimize Huffman table */
-int write_block_dry(struct context *context, uint8_t Cs, struct int_block *int_block)
+/* differential DC coding */
+static size_t dc_token(int32_t c, struct token *token)
+{
+	/* categories up to 15 for the 12-bit samples (F.1.5.1) */
+	assert(c >= -32767 && c <= +32767);
+
+	uint8_t cat = encode_cat(c);
+
+	token->value = cat;
+	token->count = cat;
+	token->extra = encode_extra(c, cat);
+
+	return 1;
+}
+
+/* r zeros followed by the coefficient c */
+static size_t ac_tokens(int r, int32_t c, struct token *token)
+{
+	size_t n = 0;
+
+	while (r > 15) {
+		/* ZRL */
+		token[n].value = 0xf0;
+		token[n].count = 0;
+		token[n].extra = 0;
+		n++;
+		r -= 16;
+	}
+
+	uint8_t cat = encode_cat(c);
+
+	token[n].value = cat_zrl_to_value(cat, (uint8_t)r);
+	token[n].count = cat;
+	token[n].extra = encode_extra(c, cat);
+	n++;
+
+	return n;
+}
+
+static size_t eob_token(struct token *token)
+{
+	token->value = 0;
+	token->count = 0;
+	token->extra = 0;
+
+	return 1;
+}
+
+/*
+ * Figure F.2 – Procedure for sequential encoding of AC coefficients with Huffman coding
+ *
+ * The block is reordered into the zigzag order, and the non-zero AC
+ * coefficients are collected into a 64-bit mask by the zigzag_block kernel.
+ * The zero runs are then given by the distances between the set bits, so
+ * the cost scales with the number of non-zero coefficients.
+ */
+static size_t make_tokens(const struct kernels *kernels, const struct int_block *int_block, int32_t pred, struct token *token)
 {
+	int32_t z[64];
+	uint64_t mask = kernels->zigzag_block(int_block, z);
+
+	size_t n = 0;
+
+	n += dc_token(z[0] - pred, token + n);
+
+	/* position of the last coded coefficient */
+	int last = 0;
+
+	while (mask != 0) {
+		int i = __builtin_ctzll(mask);
+
+		mask &= mask - 1;
+
+		n += ac_tokens(i - last - 1, z[i], token + n);
+
+		last = i;
+	}
+
+	if (last != 63) {
+		n += eob_token(token + n);
+	}
+
+	assert(n <= MAX_BLOCK_TOKENS);
+
+	return n;
+}
+
+static size_t make_sparse_tokens(const struct sparse *sparse, size_t block_seq, int32_t pred, struct token *token)
+{
+	uint64_t block = sparse->block[block_seq];
+	const struct coeff_pair *pair = sparse->pair + (block >> 7);
+	size_t count = block & 127;
+
+	size_t n = 0;
+	size_t j = 0;
+
+	if (j < count && pair[j].k == 0) {
+		j++;
+	}
+
+	n += dc_token(sparse_dc(sparse, block_seq) - pred, token + n);
+
+	int last = 0;
+
+	for (; j < count; ++j) {
+		int i = pair[j].k;
+
+		n += ac_tokens(i - last - 1, pair[j].c, token + n);
+
+		last = i;
+	}
+
+	if (last != 63) {
+		n += eob_token(token + n);
+	}
+
+	assert(n <= MAX_BLOCK_TOKENS);
+
+	return n;
+}
+
+int write_block(struct bits *bits, struct context *context, uint8_t Cs, struct int_block *int_block)
+{
+	assert(context != NULL);
+	assert(int_block != NULL);
+
+	struct token token[MAX_BLOCK_TOKENS];
+	size_t count;
+
+	make_tokens(context->kernels, int_block, 0, token);
+
+	return write_block_tokens(bits, context, Cs, token, &count);
+}
+
+static void count_tokens(const struct token *token, size_t n, struct huffenc *huffenc_dc, struct huffenc *huffenc_ac)
+{
+	huffenc_dc->freq[token[0].value]++;
+
+	for (size_t k = 1; k < n; ++k) {
+		huffenc_ac->freq[token[k].value]++;
+	}
+}
+
+size_t tokenize_block(const struct kernels *kernels, const struct int_block *int_block, int32_t pred, struct huffenc *huffenc_dc, struct huffenc *huffenc_ac, struct token *token)
+{
+	assert(kernels != NULL);
+	assert(int_block != NULL);
+	assert(huffenc_dc != NULL);
+	assert(huffenc_ac != NULL);
+	assert(token != NULL);
+
+	size_t n = make_tokens(kernels, int_block, pred, token);
+
+	count_tokens(token, n, huffenc_dc, huffenc_ac);
+
+	return n;
+}
+
+size_t tokenize_sparse_block(const struct sparse *sparse, size_t block_seq, int32_t pred, struct huffenc *huffenc_dc, struct huffenc *huffenc_ac, struct token *token)
+{
+	assert(sparse != NULL);
+	assert(huffenc_dc != NULL);
+	assert(huffenc_ac != NULL);
+	assert(token != NULL);
+
+	size_t n = make_sparse_tokens(sparse, block_seq, pred, token);
+
+	count_tokens(token, n, huffenc_dc, huffenc_ac);
+
+	return n;
+}
+
+int write_block_tokens(struct bits *bits, struct context *context, uint8_t Cs, const struct token *token, size_t *count)
+{
+	int err;
 	uint8_t Td = context->component[Cs].Td;
 	uint8_t Ta = context->component[Cs].Ta;
 
-	struct huffenc *huffenc_dc = &context->huffenc[0][Td];
-	struct huffenc *huffenc_ac = &context->huffenc[1][Ta];
+	const struct hcode *hcode_dc = &context->hcode[0][Td];
+	const struct hcode *hcode_ac = &context->hcode[1][Ta];
 
-	assert(int_block != NULL);
+	assert(token != NULL);
+	assert(count != NULL);
 
-	struct coeff_dc coeff_dc;
+	size_t n = 0;
 
-	coeff_dc.c = int_block->c[zigzag[0]];
+	/* DC */
+	err = write_code(bits, hcode_dc, token[n].value);
+	RETURN_IF(err);
+	err = write_extra_bits(bits, token[n].count, token[n].extra);
+	RETURN_IF(err);
 
-	// write_dc()
-	huffenc_dc->freq[encode_cat(coeff_dc.c)]++;
+	if (context->analysis != NULL) {
+		analysis_dc(context->analysis, Cs, Td, hcode_dc, token[n].value);
+	}
 
-	/* Figure F.2 – Procedure for sequential encoding of AC coefficients with Huffman coding */
-	for (int r = 0, i = 1; i < 64; ++i) {
-		struct coeff_ac coeff_ac;
-		coeff_ac.eob = 0;
-
-		if (int_block->c[zigzag[i]] == 0) {
-			/* zero coefficient */
-			if (i == 63) {
-				coeff_ac.eob = 1;
-				// write_ac()
-				huffenc_ac->freq[0]++;
-			} else {
-				r++;
-			}
-		} else {
-			/* non-zero coefficient */
-			while (r > 15) {
-				/* produce ZRL */
-				coeff_ac.c = 0;
-				coeff_ac.zrl = 15;
-				// write_ac()
-				huffenc_ac->freq[cat_zrl_to_value(encode_cat(coeff_ac.c), coeff_ac.zrl)]++;
-				r -= 16;
-			}
-			/* encode coefficient */
-			coeff_ac.c = int_block->c[zigzag[i]];
-			coeff_ac.zrl = r;
-			// write_ac()
-			huffenc_ac->freq[cat_zrl_to_value(encode_cat(coeff_ac.c), coeff_ac.zrl)]++;
-			r = 0;
+	n++;
+
+	/* AC, the end of block is given by EOB or by the position */
+	for (int i = 1; i < 64; ) {
+		uint8_t rs = token[n].value;
+
+		err = write_code(bits, hcode_ac, rs);
+		RETURN_IF(err);
+		err = write_extra_bits(bits, token[n].count, token[n].extra);
+		RETURN_IF(err);
+
+		if (context->analysis != NULL) {
+			analysis_ac(context->analysis, Cs, Ta, hcode_ac, rs);
 		}
+
+		n++;
+
+		if (rs == 0) {
+			/* EOB */
+			break;
+		}
+
+		/* ZRL skips 16 zeros, otherwise zero run + one coefficient */
+		i += value_to_zerorun(rs) + 1;
 	}
 
+	*count = n;
+
 	return RET_SUCCESS;
 }
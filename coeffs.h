@@ -17,8 +17,68 @@ struct flt_block {
 
 int read_block(struct bits *bits, struct context *context, uint8_t Cs, struct int_block *int_block);
 
+/* nonzero quantized coefficient */
+struct coeff_pair {
+	/* zig-zag index */
+	uint8_t k;
+	int16_t c;
+};
+
+/*
+ * Quantized coefficients of a component without the zeros, for the work
+ * in the coefficient domain.
+ *
+ * The pairs of each block are packed next to each other in the zig-zag
+ * order. The blocks absent from the store are all zero.
+ */
+struct sparse {
+	/* index of the first pair << 7 | number of pairs, for each block */
+	uint64_t *block;
+	size_t blocks;
+
+	struct coeff_pair *pair;
+	size_t pairs;
+	size_t capacity;
+};
+
+/* the block index is zero-filled */
+int alloc_sparse(struct context *context, struct component *component, size_t blocks);
+
+void free_sparse(struct sparse *sparse);
+
+/*
+ * Read the block into the store, the DC prediction is updated. The sparse
+ * is NULL when the block is past the end of the component.
+ */
+int read_block_sparse(struct bits *bits, struct context *context, uint8_t Cs, struct sparse *sparse, size_t block_seq, int32_t *pred);
+
+int32_t sparse_dc(const struct sparse *sparse, size_t block_seq);
+
 int write_block(struct bits *bits, struct context *context, uint8_t Cs, struct int_block *int_block);
 
-int write_block_dry(struct context *context, uint8_t Cs, struct int_block *int_block);
+/* Huffman-coded value followed by its extra bits */
+struct token {
+	/* DC category or AC RS symbol */
+	uint8_t value;
+	/* number of extra bits */
+	uint8_t count;
+	uint16_t extra;
+};
+
+/* the DC value + at most 63 AC values (including EOB and ZRL) */
+#define MAX_BLOCK_TOKENS 64
+
+/*
+ * Collect the coded values of the block into the token[] and their
+ * frequencies into the huffenc histograms. The DC coefficient is coded as a
+ * difference to pred. Returns the number of tokens.
+ */
+size_t tokenize_block(const struct kernels *kernels, const struct int_block *int_block, int32_t pred, struct huffenc *huffenc_dc, struct huffenc *huffenc_ac, struct token *token);
+
+/* tokenize_block() of the block in the sparse store */
+size_t tokenize_sparse_block(const struct sparse *sparse, size_t block_seq, int32_t pred, struct huffenc *huffenc_dc, struct huffenc *huffenc_ac, struct token *token);
+
+/* write the tokens of a single block, the number of tokens consumed is stored into *count */
+int write_block_tokens(struct bits *bits, struct context *context, uint8_t Cs, const struct token *token, size_t *count);
 
 #endif
@@ -2,10 +2,13 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <stdarg.h>
 #include "common.h"
 #include "mjpeg.h"
 #include "huffman.h"
 #include "coeffs.h"
+#include "arena.h"
+#include "mem.h"
 
 int init_qtable(struct qtable *qtable)
 {
@@ -24,6 +27,8 @@ int init_component(struct component *component)
 {
 	assert(component != NULL);
 
+	component->C = 0;
+
 	component->H = 0;
 	component->V = 0;
 
@@ -40,6 +45,8 @@ int init_component(struct component *component)
 
 	component->frame_buffer = NULL;
 
+	component->sparse = NULL;
+
 	return RET_SUCCESS;
 }
 
@@ -51,10 +58,8 @@ int init_htable(struct htable *htable)
 		htable->L[i] = 0;
 	}
 
-	for (int i = 0; i < 16; ++i) {
-		for (int j = 0; j < 255; ++j) {
-			htable->V[i][j] = 0;
-		}
+	for (int i = 0; i < 256; ++i) {
+		htable->V[i] = 0;
 	}
 
 	return RET_SUCCESS;
@@ -70,33 +75,30 @@ int init_context(struct context *context)
 
 	context->P = 0;
 
+	context->kernels = select_kernels(0);
+
 	context->Y = 0;
 	context->X = 0;
 
 	context->Nf = 0;
-
-	for (int i = 0; i < 256; ++i) {
-		init_component(&context->component[i]);
-	}
+	context->component = NULL;
 
 	for (int j = 0; j < 2; ++j) {
-		for (int i = 0; i < 4; ++i) {
+		for (int i = 2; i < 4; ++i) {
 			init_htable(&context->htable[j][i]);
-
-			init_huffenc(&context->huffenc[j][i]);
 		}
 	}
 
-	/* implicit MJPEG tables */
+	/* implicit MJPEG tables, with the codes derived in advance */
 	context->htable[0][0] = mjpg_htable_0_0;
 	context->htable[0][1] = mjpg_htable_0_1;
 	context->htable[1][0] = mjpg_htable_1_0;
 	context->htable[1][1] = mjpg_htable_1_1;
 
-	conv_htable_to_hcode(&context->htable[0][0], &context->hcode[0][0]);
-	conv_htable_to_hcode(&context->htable[0][1], &context->hcode[0][1]);
-	conv_htable_to_hcode(&context->htable[1][0], &context->hcode[1][0]);
-	conv_htable_to_hcode(&context->htable[1][1], &context->hcode[1][1]);
+	context->hcode[0][0] = mjpg_hcode_0_0;
+	context->hcode[0][1] = mjpg_hcode_0_1;
+	context->hcode[1][0] = mjpg_hcode_1_0;
+	context->hcode[1][1] = mjpg_hcode_1_1;
 
 	context->Ri = 0;
 
@@ -105,36 +107,86 @@ int init_context(struct context *context)
 
 	context->mblocks = 0;
 
+	context->layout = LAYOUT_RASTER;
+
+	context->pool = NULL;
+
+	context->arena = NULL;
+
+	context->pipelined = 0;
+	context->pipeline = NULL;
+
+	context->sparse = 0;
+
+	context->stats = NULL;
+	context->analysis = NULL;
+
 	return RET_SUCCESS;
 }
 
+int alloc_components(struct context *context, uint8_t Nf)
+{
+	assert(context != NULL);
+
+	free_buffers(context);
+
+	context->component = mem_malloc(MEM_OTHER, sizeof(struct component) * Nf);
+
+	if (context->component == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	context->Nf = Nf;
+
+	for (int i = 0; i < Nf; ++i) {
+		init_component(&context->component[i]);
+	}
+
+	return RET_SUCCESS;
+}
+
+int find_component(const struct context *context, uint8_t C)
+{
+	assert(context != NULL);
+
+	for (int i = 0; i < context->Nf; ++i) {
+		if (context->component[i].C == C) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
 size_t ceil_div(size_t n, size_t d)
 {
 	return (n + (d - 1)) / d;
 }
 
-int alloc_buffers(struct component *component, size_t size)
+/* the arena space taken by alloc_buffers() */
+static size_t buffers_size(size_t size)
 {
-	// redefine component (multiple definitions of the same component inside SOF marker)
-	free(component->int_buffer);
-	free(component->flt_buffer);
-	free(component->frame_buffer);
+	return arena_size(sizeof(struct int_block) * size) + arena_size(sizeof(struct flt_block) * size) + arena_size(sizeof(float) * 64 * size);
+}
 
-	component->int_buffer = malloc(sizeof(struct int_block) * size);
+int alloc_buffers(struct context *context, struct component *component, size_t size)
+{
+	assert(context != NULL);
+	assert(component != NULL);
+
+	component->int_buffer = arena_calloc(context->arena, MEM_COEFFS, sizeof(struct int_block) * size);
 
 	if (component->int_buffer == NULL) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
-	memset(component->int_buffer, 0, sizeof(struct int_block) * size);
-
-	component->flt_buffer = malloc(sizeof(struct flt_block) * size);
+	component->flt_buffer = arena_alloc(context->arena, MEM_BLOCKS, sizeof(struct flt_block) * size);
 
 	if (component->flt_buffer == NULL) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
-	component->frame_buffer = malloc(sizeof(float) * 64 * size);
+	component->frame_buffer = arena_alloc(context->arena, MEM_RASTERS, sizeof(float) * 64 * size);
 
 	if (component->frame_buffer == NULL) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
@@ -143,14 +195,17 @@ int alloc_buffers(struct component *component, size_t size)
 	return RET_SUCCESS;
 }
 
+/* the buffers themselves are released with the arena */
 void free_buffers(struct context *context)
 {
-	for (int i = 0; i < 256; ++i) {
-		free(context->component[i].int_buffer);
-		free(context->component[i].flt_buffer);
-
-		free(context->component[i].frame_buffer);
+	for (int i = 0; i < context->Nf; ++i) {
+		free_sparse(context->component[i].sparse);
 	}
+
+	mem_free(MEM_OTHER, context->component);
+
+	context->component = NULL;
+	context->Nf = 0;
 }
 
 int compute_no_blocks_and_alloc_buffers(struct context *context)
@@ -171,9 +226,27 @@ int compute_no_blocks_and_alloc_buffers(struct context *context)
 	context->m_x = ceil_div(X, 8 * max_H);
 	context->m_y = ceil_div(Y, 8 * max_V);
 
-	printf("Expecting %zu macroblocks\n", context->m_x * context->m_y);
+	msg_debug("Expecting %zu macroblocks\n", context->m_x * context->m_y);
 
-	for (int i = 0; i < 256; ++i) {
+	/* one reservation for all the components */
+	size_t size = 0;
+
+	for (int i = 0; i < context->Nf; ++i) {
+		struct component *component = &context->component[i];
+
+		size_t blocks = ceil_div(X, 8 * max_H) * component->H * ceil_div(Y, 8 * max_V) * component->V;
+
+		if (context->sparse) {
+			size += arena_size(sizeof(struct sparse)) + arena_size(sizeof(uint64_t) * blocks);
+		} else {
+			size += buffers_size(blocks);
+		}
+	}
+
+	err = arena_reserve(context->arena, size);
+	RETURN_IF(err);
+
+	for (int i = 0; i < context->Nf; ++i) {
 		uint8_t H, V;
 		H = context->component[i].H;
 		V = context->component[i].V;
@@ -184,9 +257,13 @@ int compute_no_blocks_and_alloc_buffers(struct context *context)
 			context->component[i].b_x = b_x;
 			context->component[i].b_y = b_y;
 
-			printf("C = %i: %zu blocks (x=%zu y=%zu)\n", i, b_x * b_y, b_x, b_y);
+			msg_debug("C = %i: %zu blocks (x=%zu y=%zu)\n", context->component[i].C, b_x * b_y, b_x, b_y);
 
-			err = alloc_buffers(&context->component[i], b_x * b_y);
+			if (context->sparse) {
+				err = alloc_sparse(context, &context->component[i], b_x * b_y);
+			} else {
+				err = alloc_buffers(context, &context->component[i], b_x * b_y);
+			}
 			RETURN_IF(err);
 		}
 	}
@@ -223,3 +300,18 @@ void init_huffenc(struct huffenc *huffenc)
 		huffenc->others[i] = -1;
 	}
 }
+
+FILE *msg_stream = NULL;
+
+int msg_level = MSG_INFO;
+
+void msg_print(const char *format, ...)
+{
+	assert(msg_stream != NULL);
+
+	va_list ap;
+
+	va_start(ap, format);
+	vfprintf(msg_stream, format, ap);
+	va_end(ap);
+}
@@ -3,6 +3,15 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include "kernels.h"
+
+struct pool;
+struct pipeline;
+struct arena;
+struct sparse;
+struct stats;
+struct analysis;
 
 /**
  * \brief Error codes
@@ -42,6 +51,50 @@ static const uint8_t zigzag[64] = {
 	53, 60, 61, 54, 47, 55, 62, 63
 };
 
+/* layout of blocks within component buffers */
+enum {
+	LAYOUT_RASTER = 0, /**< raster order of blocks, block_y * b_x + block_x */
+	LAYOUT_MCU    = 1  /**< MCU-major order, blocks of one MCU next to each other */
+};
+
+/* message levels */
+enum {
+	MSG_ERROR = 0,
+	MSG_WARN  = 1,
+	MSG_INFO  = 2,
+	MSG_DEBUG = 3,
+	MSG_TRACE = 4
+};
+
+/* the messages above this level are not compiled in */
+#ifndef MSG_MAX_LEVEL
+#	define MSG_MAX_LEVEL MSG_TRACE
+#endif
+
+/* messages are printed here, NULL = silent (the default) */
+extern FILE *msg_stream;
+
+/* the messages above this level are dropped at run time, MSG_INFO by default */
+extern int msg_level;
+
+#define msg_enabled(level) ((level) <= MSG_MAX_LEVEL && (level) <= msg_level && msg_stream != NULL)
+
+/* printf() into the msg_stream, use the macros below */
+void msg_print(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+#define msg_at(level, ...) \
+	do { \
+		if (msg_enabled(level)) { \
+			msg_print(__VA_ARGS__); \
+		} \
+	} while (0)
+
+#define msg_error(...) msg_at(MSG_ERROR, __VA_ARGS__)
+#define msg_warn(...)  msg_at(MSG_WARN, __VA_ARGS__)
+#define msg_info(...)  msg_at(MSG_INFO, __VA_ARGS__)
+#define msg_debug(...) msg_at(MSG_DEBUG, __VA_ARGS__)
+#define msg_trace(...) msg_at(MSG_TRACE, __VA_ARGS__)
+
 #define RETURN_IF(err) \
 	do { \
 		if (err) { \
@@ -57,6 +110,9 @@ struct qtable {
 };
 
 struct component {
+	/* Component identifier */
+	uint8_t C;
+
 	/* Horizontal sampling factor, Vertical sampling factor */
 	uint8_t H, V;
 	/* Quantization table destination selector */
@@ -77,6 +133,9 @@ struct component {
 
 	/* raster image */
 	float *frame_buffer;
+
+	/* the coefficients without the zeros, instead of the buffers above */
+	struct sparse *sparse;
 };
 
 /*
@@ -86,30 +145,30 @@ struct htable {
 	/* Number of Huffman codes of length i */
 	uint8_t L[16];
 
-	/*  Value associated with each Huffman code */
-	uint8_t V[16][255];
+	/* Value associated with each Huffman code, in the order of increasing code length */
+	uint8_t V[256];
 };
 
 /*
  * This reflects Annex C
  */
 struct hcode {
-	/* unrolled htable.V[] */
-	uint8_t huff_val[16 * 255];
+	/* copy of htable.V[] */
+	uint8_t huff_val[256];
 
 	/* contains a list of code lengths */
-	size_t huff_size[256];
+	uint8_t huff_size[256];
 	/*  contains the Huffman codes corresponding to those lengths */
 	uint16_t huff_code[256];
 
 	/* the index of the last entry in the table */
-	size_t last_k;
+	uint16_t last_k;
 
 	/* EHUFCO and EHUFSI, are created by reordering the codes specified by
 	 * HUFFCODE and HUFFSIZE according to the symbol values assigned to each code
 	 */
 	uint16_t e_huf_co[256];
-	size_t e_huf_si[256];
+	uint8_t e_huf_si[256];
 };
 
 /* K.2 A procedure for generating the lists which specify a Huffman code table */
@@ -118,7 +177,7 @@ struct huffenc {
 	size_t codesize[257];
 	int others[257];
 	size_t bits[33]; // 0..32, corresponds to htable.L[]
-	uint8_t huff_val[16 * 255]; // to hcode.huff_val[] => htable.V[]
+	uint8_t huff_val[257]; // to htable.V[]
 };
 
 struct context {
@@ -129,19 +188,22 @@ struct context {
 	/*  Sample precision */
 	uint8_t P;
 
+	/* kernels specialized for the sample precision, chosen at SOF */
+	const struct kernels *kernels;
+
 	/* Number of lines, Number of samples per line */
 	uint16_t Y, X;
 
 	/* Number of image components in frame */
 	uint8_t Nf;
 
-	struct component component[256];
+	/* Nf components in the order of the frame header, see alloc_components() */
+	struct component *component;
 
 	/* there are two types of tables, DC and AC; the identifiers are not unique accross these types */
 	/* indices: [0=DC/1=AC][identifier] */
 	struct htable htable[2][4];
 	struct hcode hcode[2][4];
-	struct huffenc huffenc[2][4];
 
 	/* Restart interval */
 	uint16_t Ri;
@@ -153,8 +215,45 @@ struct context {
 	size_t mblocks;
 
 	uint8_t max_H, max_V;
+
+	/* layout of int_buffer[] and flt_buffer[] blocks */
+	uint8_t layout;
+
+	/* thread pool for the block and raster stages, NULL = single-threaded */
+	struct pool *pool;
+
+	/* the component buffers and the frames */
+	struct arena *arena;
+
+	/* overlap the entropy coding with the other stages */
+	uint8_t pipelined;
+
+	/* keep the quantized coefficients only, in the sparse store */
+	uint8_t sparse;
+
+	/* decoder: reconstruction running alongside the entropy decoding */
+	struct pipeline *pipeline;
+
+	/* stage timings, NULL = not collected */
+	struct stats *stats;
+
+	/* bitstream statistics, NULL = not collected */
+	struct analysis *analysis;
 };
 
+/* index of the block at (block_x, block_y) within the component buffers */
+static inline size_t block_index(const struct context *context, const struct component *component, size_t block_x, size_t block_y)
+{
+	if (context->layout == LAYOUT_MCU) {
+		size_t H = component->H;
+		size_t V = component->V;
+
+		return ((block_y / V) * context->m_x + block_x / H) * H * V + (block_y % V) * H + block_x % H;
+	}
+
+	return block_y * component->b_x + block_x;
+}
+
 void init_huffenc(struct huffenc *huffenc);
 
 int init_qtable(struct qtable *qtable);
@@ -165,7 +264,13 @@ int init_htable(struct htable *htable);
 
 int init_context(struct context *context);
 
-int alloc_buffers(struct component *component, size_t size);
+/* allocate Nf blank components, the previous ones are released */
+int alloc_components(struct context *context, uint8_t Nf);
+
+/* index of the component with the identifier C, or -1 */
+int find_component(const struct context *context, uint8_t C);
+
+int alloc_buffers(struct context *context, struct component *component, size_t size);
 
 void free_buffers(struct context *context);
 
@@ -0,0 +1,1105 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "common.h"
+#include "io.h"
+#include "huffman.h"
+#include "coeffs.h"
+#include "imgproc.h"
+#include "frame.h"
+#include "pool.h"
+#include "ring.h"
+#include "source.h"
+#include "mem.h"
+#include "stats.h"
+#include "probes.h"
+#include "decode.h"
+
+void init_decoder_params(struct decoder_params *params)
+{
+	assert(params != NULL);
+
+	params->layout = LAYOUT_RASTER;
+
+	params->threads = 1;
+
+	params->pipelined = 0;
+
+	params->arena = NULL;
+
+	params->stats = NULL;
+
+	params->analysis = NULL;
+}
+
+static const char *const Pq_to_str[] = {
+	[0] = "8-bit",
+	[1] = "16-bit"
+};
+
+/* B.2.4.1 Quantization table-specification syntax */
+int parse_qtable(struct source *source, struct context *context)
+{
+	int err;
+	uint8_t Pq, Tq;
+	struct qtable *qtable;
+
+	assert(context != NULL);
+
+	err = read_nibbles(source, &Pq, &Tq);
+	RETURN_IF(err);
+
+	if (Tq >= 4) {
+		/* invalid value */
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	assert(Tq < 4);
+	assert(Pq < 2);
+
+	msg_debug("Pq = %" PRIu8 " (%s), Tq = %" PRIu8 " (QT identifier)\n", Pq, Pq_to_str[Pq], Tq);
+
+	qtable = &context->qtable[Tq];
+
+	/* precision */
+	qtable->Pq = Pq;
+
+	for (int i = 0; i < 64; ++i) {
+		if (Pq == 0) {
+			uint8_t byte;
+			err = read_byte(source, &byte);
+			RETURN_IF(err);
+			qtable->Q[zigzag[i]] = (uint16_t)byte;
+		} else {
+			uint16_t word;
+			err = read_word(source, &word);
+			RETURN_IF(err);
+			qtable->Q[zigzag[i]] = word;
+		}
+	}
+
+	/* skip the loop unless printed */
+	if (msg_enabled(MSG_TRACE)) {
+		for (int y = 0; y < 8; ++y) {
+			for (int x = 0; x < 8; ++x) {
+				msg_print("%3" PRIu16 " ", qtable->Q[y * 8 + x]);
+			}
+			msg_print("\n");
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+int parse_frame_header(struct source *source, struct context *context)
+{
+	int err;
+	/* Sample precision */
+	uint8_t P;
+	/* Number of lines, Number of samples per line */
+	uint16_t Y, X;
+	/* Number of image components in frame */
+	uint8_t Nf;
+
+	assert(context != NULL);
+
+	err = read_byte(source, &P);
+	RETURN_IF(err);
+	err = read_word(source, &Y);
+	RETURN_IF(err);
+	err = read_word(source, &X);
+	RETURN_IF(err);
+	err = read_byte(source, &Nf);
+	RETURN_IF(err);
+
+	assert(X > 0);
+	assert(Nf > 0);
+
+	msg_debug("P = %" PRIu8 " (Sample precision), Y = %" PRIu16 ", X = %" PRIu16 ", Nf = %" PRIu8 " (Number of image components)\n", P, Y, X, Nf);
+
+	/* precision */
+	context->P = P;
+	context->kernels = select_kernels(P);
+
+	context->Y = Y;
+	context->X = X;
+
+	/* components */
+	err = alloc_components(context, Nf);
+	RETURN_IF(err);
+
+	/* the components defined so far */
+	context->Nf = 0;
+
+	uint8_t max_H = 0, max_V = 0;
+
+	for (int i = 0; i < Nf; ++i) {
+		uint8_t C;
+		uint8_t H, V;
+		uint8_t Tq;
+
+		err = read_byte(source, &C);
+		RETURN_IF(err);
+		err = read_nibbles(source, &H, &V);
+		RETURN_IF(err);
+		err = read_byte(source, &Tq);
+		RETURN_IF(err);
+
+		msg_debug("C = %" PRIu8 " (Component identifier), H = %" PRIu8 ", V = %" PRIu8 ", Tq = %" PRIu8 " (QT identifier)\n", C, H, V, Tq);
+
+		/* a repeated identifier redefines the component */
+		int n = find_component(context, C);
+
+		if (n < 0) {
+			n = context->Nf++;
+		}
+
+		context->component[n].C = C;
+		context->component[n].H = H;
+		context->component[n].V = V;
+		context->component[n].Tq = Tq;
+
+		max_H = (H > max_H) ? H : max_H;
+		max_V = (V > max_V) ? V : max_V;
+	}
+
+	context->max_H = max_H;
+	context->max_V = max_V;
+
+	err = compute_no_blocks_and_alloc_buffers(context);
+	RETURN_IF(err);
+
+	return RET_SUCCESS;
+}
+
+static const char *const Tc_to_str[] = {
+	[0] = "DC",
+	[1] = "AC"
+};
+
+int parse_huffman_tables(struct source *source, struct context *context)
+{
+	int err;
+	uint8_t Tc, Th;
+
+	assert(context != NULL);
+
+	err = read_nibbles(source, &Tc, &Th);
+	RETURN_IF(err);
+
+	if (Tc >= 2) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	assert(Tc < 2);
+
+	msg_debug("Tc = %" PRIu8 " (%s table) Th = %" PRIu8 " (HT identifier)\n", Tc, Tc_to_str[Tc], Th);
+
+	struct htable *htable = &context->htable[Tc][Th];
+
+	for (int i = 0; i < 16; ++i) {
+		err = read_byte(source, &htable->L[i]);
+		RETURN_IF(err);
+	}
+
+	size_t values = 0;
+
+	for (int i = 0; i < 16; ++i) {
+		values += htable->L[i];
+	}
+
+	if (values > 256) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	for (size_t k = 0; k < values; ++k) {
+		err = read_byte(source, &htable->V[k]);
+		RETURN_IF(err);
+	}
+
+	/* Annex C */
+	struct hcode *hcode = &context->hcode[Tc][Th];
+
+	err = conv_htable_to_hcode(htable, hcode);
+	RETURN_IF(err);
+
+	return RET_SUCCESS;
+}
+
+struct scan {
+	uint8_t Ns;
+	uint8_t Cs[256];
+
+	/* useful to remove differential DC coding
+	 *
+	 * At the beginning of the scan and at the beginning of each restart interval, the prediction for the DC coefficient prediction
+	 * is initialized to 0. */
+	struct int_block *last_block[256];
+
+	/* the same for the sparse store */
+	int32_t pred[256];
+
+	/* number of scans so far */
+	size_t count;
+};
+
+int parse_scan_header(struct source *source, struct context *context, struct scan *scan)
+{
+	int err;
+	/* Number of image components in scan */
+	uint8_t Ns;
+
+	err = read_byte(source, &Ns);
+	RETURN_IF(err);
+
+	msg_debug("Ns = %" PRIu8 " (Number of image components in scan)\n", Ns);
+
+	assert(scan != NULL);
+
+	scan->Ns = Ns;
+
+	for (int j = 0; j < Ns; ++j) {
+		uint8_t Cs;
+		uint8_t Td, Ta;
+
+		err = read_byte(source, &Cs);
+		RETURN_IF(err);
+		err = read_nibbles(source, &Td, &Ta);
+		RETURN_IF(err);
+
+		msg_debug("Cs%i = %" PRIu8 " (Component identifier), Td%i = %" PRIu8 " (DC HT identifier), Ta%i = %" PRIu8 " (AC HT identifier)\n", j, Cs, j, Td, j, Ta);
+
+		int i = find_component(context, Cs);
+
+		if (i < 0) {
+			msg_error("Undefined component %" PRIu8 "\n", Cs);
+			return RET_FAILURE_FILE_UNSUPPORTED;
+		}
+
+		/* index into context->component[] */
+		scan->Cs[j] = (uint8_t)i;
+
+		context->component[i].Td = Td;
+		context->component[i].Ta = Ta;
+	}
+
+	uint8_t Ss;
+	uint8_t Se;
+	uint8_t Ah, Al;
+
+	err = read_byte(source, &Ss);
+	RETURN_IF(err);
+	err = read_byte(source, &Se);
+	RETURN_IF(err);
+	err = read_nibbles(source, &Ah, &Al);
+	RETURN_IF(err);
+
+	if (Ss != 0 || Se != 63) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	assert(Ss == 0);
+	assert(Se == 63);
+	msg_debug("Ss = %" PRIu8 " (the first DCT coefficient), Se = %" PRIu8 " (the last DCT coefficient)\n", Ss, Se);
+
+	if (Ah != 0 || Al != 0) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	assert(Ah == 0);
+	assert(Al == 0);
+	msg_debug("Ah = %" PRIu8 " (bit position high), Al = %" PRIu8 " (bit position low)\n", Ah, Al);
+
+	context->mblocks = 0;
+
+	scan->count++;
+
+	return RET_SUCCESS;
+}
+
+/* read MCU */
+int read_macroblock(struct bits *bits, struct context *context, struct scan *scan)
+{
+	int err;
+
+	assert(scan != NULL);
+	assert(context != NULL);
+
+	size_t seq_no = context->mblocks;
+
+	if (scan->Ns == 0) {
+		/* nothing to do */
+		return RET_FAILURE_NO_MORE_DATA;
+	} else if (scan->Ns == 1) {
+		/* A.2.2 Non-interleaved order (Ns = 1) */
+		assert(scan->Ns == 1);
+
+		uint8_t Cs = scan->Cs[0];
+
+		uint8_t H = context->component[Cs].H;
+		uint8_t V = context->component[Cs].V;
+
+		size_t blocks_in_mb = H * V;
+
+		for (size_t w = 0; w < blocks_in_mb; ++w) {
+			size_t block_x = (blocks_in_mb * seq_no + w) % context->component[Cs].b_x;
+			size_t block_y = (blocks_in_mb * seq_no + w) / context->component[Cs].b_x;
+
+			size_t block_seq = block_index(context, &context->component[Cs], block_x, block_y);
+
+			if (context->sparse) {
+				err = read_block_sparse(bits, context, Cs, context->component[Cs].sparse, block_seq, &scan->pred[Cs]);
+				RETURN_IF(err);
+				continue;
+			}
+
+			struct int_block *int_block = &context->component[Cs].int_buffer[block_seq];
+
+			/* read block */
+			err = read_block(bits, context, Cs, int_block);
+			RETURN_IF(err);
+
+			if (scan->last_block[Cs] != NULL) {
+				int_block->c[0] += scan->last_block[Cs]->c[0];
+			}
+
+			scan->last_block[Cs] = int_block;
+		}
+	} else {
+		assert(scan->Ns > 1);
+
+		if (context->m_x == 0) {
+			/* missing SOF before SOS? */
+			return RET_FAILURE_FILE_UNSUPPORTED;
+		}
+
+		assert(context->m_x != 0);
+
+		size_t x = seq_no % context->m_x;
+		size_t y = seq_no / context->m_x;
+
+		msg_trace("Macroblock x = %zu, y = %zu\n", x, y);
+
+		/* for each component */
+		for (int j = 0; j < scan->Ns; ++j) {
+			uint8_t Cs = scan->Cs[j];
+			uint8_t H = context->component[Cs].H;
+			uint8_t V = context->component[Cs].V;
+
+			/* for each 8x8 block */
+			for (int v = 0; v < V; ++v) {
+				for (int h = 0; h < H; ++h) {
+					size_t block_x = x * H + h;
+					size_t block_y = y * V + v;
+
+					assert(block_x < context->component[Cs].b_x);
+
+					size_t block_seq = block_index(context, &context->component[Cs], block_x, block_y);
+
+					msg_trace("Cs = %" PRIu8 ": block x = %zu, y = %zu (block# %zu out of %zu)\n", Cs, block_x, block_y, block_seq, context->component[Cs].b_x * context->component[Cs].b_y);
+
+					/* past the end of data? */
+					int past_end = block_seq >= context->component[Cs].b_x * context->component[Cs].b_y;
+
+					if (context->sparse) {
+						err = read_block_sparse(bits, context, Cs, past_end ? NULL : context->component[Cs].sparse, block_seq, &scan->pred[Cs]);
+						RETURN_IF(err);
+						continue;
+					}
+
+					struct int_block *int_block = &context->component[Cs].int_buffer[block_seq];
+
+					if (past_end) {
+						int_block = NULL;
+					}
+
+					/* read block */
+					err = read_block(bits, context, Cs, int_block);
+					RETURN_IF(err);
+
+					/* remove differential DC coding */
+					if (scan->last_block[Cs] != NULL) {
+						int_block->c[0] += scan->last_block[Cs]->c[0];
+					}
+
+					scan->last_block[Cs] = int_block;
+				}
+			}
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+/*
+ * Reconstruction of MCU rows running alongside the entropy decoding.
+ *
+ * After each complete MCU row, the decoding thread publishes its index
+ * through the ring. The worker threads dequantize, transform, upsample and
+ * color-convert the published rows into the frame. Only a single scan
+ * containing all components can be pipelined.
+ */
+struct pipeline {
+	struct context *context;
+
+	struct ring ring;
+
+	int threads;
+	pthread_t *thread;
+
+	/* number of MCU rows in the frame */
+	size_t rows;
+	/* rows published so far */
+	size_t published;
+
+	/* the output frame */
+	struct frame frame;
+};
+
+static void reconstruct_row(struct pipeline *pipeline, size_t row)
+{
+	struct context *context = pipeline->context;
+	struct frame *frame = &pipeline->frame;
+
+	// component id
+	int compno = 0;
+
+	for (int i = 0; i < context->Nf; ++i) {
+		struct component *component = &context->component[i];
+
+		if (component->int_buffer != NULL) {
+			size_t V = component->V;
+			size_t b_x = component->b_x;
+
+			/* the row occupies consecutive blocks in any layout */
+			size_t begin = row * V * b_x;
+			size_t end = (row + 1) * V * b_x;
+
+			dequantize_blocks(context, component, begin, end);
+			inverse_dct_blocks(context, component, begin, end);
+			conv_blocks_to_frame_rows(context, component, row * V, (row + 1) * V);
+			transform_component_to_frame_rows(component, compno, frame, row * V * 8, (row + 1) * V * 8);
+
+			compno++;
+		}
+	}
+
+	size_t y0 = row * context->max_V * 8;
+	size_t y1 = y0 + context->max_V * 8;
+
+	if (y1 > frame->Y) {
+		y1 = frame->Y;
+	}
+
+	if (y0 < y1) {
+		frame_to_rgb_rows(frame, y0, y1);
+	}
+}
+
+static void *pipeline_worker(void *arg)
+{
+	struct pipeline *pipeline = arg;
+	size_t row;
+
+	while (ring_pop(&pipeline->ring, &row) == RET_SUCCESS) {
+		reconstruct_row(pipeline, row);
+	}
+
+	return NULL;
+}
+
+/* wait for the workers */
+void pipeline_finish(struct context *context)
+{
+	struct pipeline *pipeline = context->pipeline;
+
+	if (pipeline == NULL || pipeline->thread == NULL) {
+		return;
+	}
+
+	ring_close(&pipeline->ring);
+
+	for (int i = 0; i < pipeline->threads; ++i) {
+		pthread_join(pipeline->thread[i], NULL);
+	}
+
+	mem_free(MEM_OTHER, pipeline->thread);
+	pipeline->thread = NULL;
+}
+
+void pipeline_destroy(struct context *context)
+{
+	struct pipeline *pipeline = context->pipeline;
+
+	if (pipeline == NULL) {
+		return;
+	}
+
+	pipeline_finish(context);
+
+	frame_destroy(&pipeline->frame);
+	ring_free(&pipeline->ring);
+
+	mem_free(MEM_OTHER, pipeline);
+
+	context->pipeline = NULL;
+}
+
+int pipeline_start(struct context *context, struct scan *scan)
+{
+	int err;
+
+	assert(context != NULL);
+	assert(scan != NULL);
+
+	/* the frame from previous scan is not final */
+	pipeline_destroy(context);
+
+	if (!context->pipelined || scan->count != 1 || scan->Ns != context->Nf || context->m_x == 0) {
+		return RET_SUCCESS;
+	}
+
+	struct pipeline *pipeline = mem_malloc(MEM_OTHER, sizeof(struct pipeline));
+
+	if (pipeline == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	pipeline->context = context;
+	pipeline->rows = context->m_y;
+	pipeline->published = 0;
+	pipeline->threads = pool_threads(context->pool);
+
+	err = ring_init(&pipeline->ring, pipeline->rows);
+
+	if (err) {
+		mem_free(MEM_OTHER, pipeline);
+		return err;
+	}
+
+	err = frame_create_blank(context, &pipeline->frame);
+
+	if (err) {
+		ring_free(&pipeline->ring);
+		mem_free(MEM_OTHER, pipeline);
+		return err;
+	}
+
+	pipeline->thread = mem_malloc(MEM_OTHER, sizeof(pthread_t) * pipeline->threads);
+
+	if (pipeline->thread == NULL) {
+		frame_destroy(&pipeline->frame);
+		ring_free(&pipeline->ring);
+		mem_free(MEM_OTHER, pipeline);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	context->pipeline = pipeline;
+
+	for (int i = 0; i < pipeline->threads; ++i) {
+		if (pthread_create(&pipeline->thread[i], NULL, pipeline_worker, pipeline) != 0) {
+			pipeline->threads = i;
+			pipeline_destroy(context);
+			return RET_FAILURE_LOGIC_ERROR;
+		}
+	}
+
+	msg_debug("Pipelined reconstruction with %i threads\n", pipeline->threads);
+
+	return RET_SUCCESS;
+}
+
+/* number of MCU rows completely decoded */
+size_t completed_rows(struct context *context, struct scan *scan)
+{
+	if (scan->Ns > 1) {
+		return context->mblocks / context->m_x;
+	}
+
+	/* non-interleaved: MCU = block(s) in raster order */
+	struct component *component = &context->component[scan->Cs[0]];
+	size_t blocks = context->mblocks * component->H * component->V;
+
+	return blocks / component->b_x / component->V;
+}
+
+void pipeline_publish(struct context *context, struct scan *scan)
+{
+	struct pipeline *pipeline = context->pipeline;
+
+	if (pipeline == NULL || pipeline->thread == NULL) {
+		return;
+	}
+
+	size_t rows = completed_rows(context, scan);
+
+	if (rows > pipeline->rows) {
+		rows = pipeline->rows;
+	}
+
+	while (pipeline->published < rows) {
+		ring_push(&pipeline->ring, pipeline->published++);
+	}
+}
+
+int read_ecs(struct source *source, struct context *context, struct scan *scan)
+{
+	int err;
+	struct bits bits;
+
+	init_bits_source(&bits, source);
+
+	for (int i = 0; i < 256; ++i) {
+		scan->last_block[i] = NULL;
+		scan->pred[i] = 0;
+	}
+
+	/* loop over macroblocks */
+	do {
+		err = read_macroblock(&bits, context, scan);
+		if (err == RET_FAILURE_NO_MORE_DATA)
+			goto end;
+		RETURN_IF(err);
+		context->mblocks++;
+		pipeline_publish(context, scan);
+	} while (1);
+
+end:
+	msg_debug("Processed: %zu macroblocks\n", context->mblocks);
+
+	return RET_SUCCESS;
+}
+
+int parse_restart_interval(struct source *source, struct context *context)
+{
+	int err;
+	uint16_t Ri;
+
+	err = read_word(source, &Ri);
+	RETURN_IF(err);
+
+	context->Ri = Ri;
+
+	return RET_SUCCESS;
+}
+
+int parse_comment(struct source *source, uint16_t len)
+{
+	if (len < 2) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	assert(len >= 2);
+
+	size_t l = len - 2;
+
+	/* printed in place */
+	if (source_fill(source, l)) {
+		return RET_FAILURE_FILE_IO;
+	}
+
+	msg_info("%.*s\n", (int)l, (const char *)source->data + source->pos);
+
+	source->pos += l;
+
+	return RET_SUCCESS;
+}
+
+int write_output(struct context *context, struct frame *frame, const struct decoder_output *output)
+{
+	stats_stage(context->stats, STAGE_PNM);
+
+	if (context->stats != NULL) {
+		context->stats->bytes_out = (int64_t)frame_pnm_size(frame);
+	}
+
+	if (output->stream != NULL) {
+		return write_frame_stream(frame, output->stream);
+	}
+
+	return write_frame(frame, output->path);
+}
+
+int write_image(struct context *context, const struct decoder_output *output)
+{
+	int err;
+
+	struct frame frame;
+
+	stats_stage(context->stats, STAGE_SAMPLING);
+
+	err = frame_create(context, &frame);
+	RETURN_IF(err);
+
+	stats_stage(context->stats, STAGE_COLOR);
+
+	err = frame_to_rgb(&frame);
+
+	if (err) {
+		goto end;
+	}
+
+	err = write_output(context, &frame, output);
+
+end:
+	frame_destroy(&frame);
+
+	return err;
+}
+
+int epilogue(struct context *context, const struct decoder_output *output)
+{
+	int err;
+
+	/* the coefficients are the result */
+	if (context->sparse) {
+		return RET_SUCCESS;
+	}
+
+	struct pipeline *pipeline = context->pipeline;
+
+	if (pipeline != NULL) {
+		/* the rest of the reconstruction, see struct stats */
+		stats_stage(context->stats, STAGE_ENTROPY);
+
+		pipeline_finish(context);
+
+		/* all rows reconstructed */
+		if (pipeline->published == pipeline->rows) {
+			return write_output(context, &pipeline->frame, output);
+		}
+
+		msg_warn("Incomplete pipelined scan, reconstructing the whole frame\n");
+	}
+
+	stats_stage(context->stats, STAGE_QUANTIZATION);
+	PROBE0(dequantize__start);
+	err = dequantize(context);
+	PROBE1(dequantize__done, err);
+	RETURN_IF(err);
+	stats_stage(context->stats, STAGE_DCT);
+	PROBE0(inverse_dct__start);
+	err = inverse_dct(context);
+	PROBE1(inverse_dct__done, err);
+	RETURN_IF(err);
+	stats_stage(context->stats, STAGE_BLOCKS);
+	err = conv_blocks_to_frame(context);
+	RETURN_IF(err);
+	PROBE0(write_image__start);
+	err = write_image(context, output);
+	PROBE1(write_image__done, err);
+	RETURN_IF(err);
+
+	return RET_SUCCESS;
+}
+
+int parse_format(struct source *source, struct context *context, const struct decoder_output *output)
+{
+	int err;
+
+	struct scan scan;
+
+	// init
+	scan.Ns = 0;
+	scan.count = 0;
+
+	while (1) {
+		uint16_t marker;
+
+		err = read_marker(source, &marker);
+		RETURN_IF(err);
+
+		PROBE2(marker, marker, source_tell(source));
+
+		/* An asterisk (*) indicates a marker which stands alone,
+		 * that is, which is not the start of a marker segment. */
+		switch (marker) {
+			uint16_t len;
+			size_t pos;
+
+			/* SOI* Start of image */
+			case 0xffd8:
+				msg_debug("SOI\n");
+				break;
+			/* APPn */
+			case 0xffe0:
+			case 0xffe1:
+			case 0xffe2:
+			case 0xffe3:
+			case 0xffe4:
+			case 0xffe5:
+			case 0xffe6:
+			case 0xffe7:
+			case 0xffe8:
+			case 0xffeb:
+			case 0xffec:
+			case 0xffed:
+			case 0xffee:
+				msg_debug("APP%i\n", marker & 0xf);
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				err = skip_segment(source, len);
+				RETURN_IF(err);
+				break;
+			/* DQT Define quantization table(s) */
+			case 0xffdb:
+				msg_debug("DQT\n");
+				pos = source_tell(source);
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				do {
+					err = parse_qtable(source, context);
+					RETURN_IF(err);
+				} while (source_tell(source) < pos + len);
+				break;
+			/* SOF0 Baseline DCT */
+			case 0xffc0:
+				msg_debug("SOF0\n");
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				err = parse_frame_header(source, context);
+				RETURN_IF(err);
+				break;
+			/* SOF1 Extended sequential DCT */
+			case 0xffc1:
+				msg_debug("SOF1\n");
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				err = parse_frame_header(source, context);
+				RETURN_IF(err);
+				break;
+			/* SOF2 Progressive DCT */
+			case 0xffc2:
+				msg_debug("SOF2\n");
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				err = parse_frame_header(source, context);
+				RETURN_IF(err);
+				msg_error("Progressive DCT not supported!\n");
+				return RET_FAILURE_FILE_UNSUPPORTED;
+			/* SOF3 Lossless (sequential) */
+			case 0xffc3:
+				msg_debug("SOF3\n");
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				err = parse_frame_header(source, context);
+				RETURN_IF(err);
+				msg_error("Lossless JPEG not supported!\n");
+				return RET_FAILURE_FILE_UNSUPPORTED;
+			/* SOF9 Extended sequential DCT (arithmetic coding) */
+			case 0xffc9:
+				msg_debug("SOF9\n");
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				err = parse_frame_header(source, context);
+				RETURN_IF(err);
+				msg_error("Arithmetic coding not supported!\n");
+				return RET_FAILURE_FILE_UNSUPPORTED;
+			/* SOF10 Progressive DCT (arithmetic coding) */
+			case 0xffca:
+				msg_debug("SOF10\n");
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				err = parse_frame_header(source, context);
+				RETURN_IF(err);
+				msg_error("Arithmetic coding not supported!\n");
+				return RET_FAILURE_FILE_UNSUPPORTED;
+			/* DHT Define Huffman table(s) */
+			case 0xffc4:
+				msg_debug("DHT\n");
+				pos = source_tell(source);
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				/* parse multiple tables in single DHT */
+				do {
+					err = parse_huffman_tables(source, context);
+					RETURN_IF(err);
+				} while (source_tell(source) < pos + len);
+				break;
+			/* SOS Start of scan */
+			case 0xffda:
+				msg_debug("SOS\n");
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				err = parse_scan_header(source, context, &scan);
+				RETURN_IF(err);
+				err = pipeline_start(context, &scan);
+				RETURN_IF(err);
+				stats_stage(context->stats, STAGE_ENTROPY);
+				PROBE0(read_ecs__start);
+				err = read_ecs(source, context, &scan);
+				PROBE1(read_ecs__done, err);
+				RETURN_IF(err);
+				stats_stage(context->stats, STAGE_MARKERS);
+				break;
+			/* EOI* End of image */
+			case 0xffd9:
+				msg_debug("EOI\n");
+				pos = source_drain(source);
+				if (pos > 0) {
+					msg_warn("*** %zu bytes of garbage ***\n", pos);
+				}
+				err = epilogue(context, output);
+				RETURN_IF(err);
+				return RET_SUCCESS;
+			/* DRI Define restart interval */
+			case 0xffdd:
+				msg_debug("DRI\n");
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				err = parse_restart_interval(source, context);
+				RETURN_IF(err);
+				break;
+			/* RSTm* Restart with modulo 8 count “m” */
+			case 0xffd0:
+			case 0xffd1:
+			case 0xffd2:
+			case 0xffd3:
+			case 0xffd4:
+			case 0xffd5:
+			case 0xffd6:
+			case 0xffd7:
+				msg_debug("RST%i\n", marker & 0xf);
+				PROBE2(restart, marker & 0xf, context->mblocks);
+				stats_stage(context->stats, STAGE_ENTROPY);
+				PROBE0(read_ecs__start);
+				err = read_ecs(source, context, &scan);
+				PROBE1(read_ecs__done, err);
+				RETURN_IF(err);
+				stats_stage(context->stats, STAGE_MARKERS);
+				break;
+			/* COM Comment */
+			case 0xfffe:
+				msg_debug("COM\n");
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				err = parse_comment(source, len);
+				RETURN_IF(err);
+				break;
+			/* TEM* For temporary private use in arithmetic coding */
+			case 0xff01:
+				msg_debug("TEM\n");
+				break;
+			/* DAC Define arithmetic coding conditioning(s) */
+			case 0xffcc:
+				msg_debug("DAC\n");
+				err = read_length(source, &len);
+				RETURN_IF(err);
+				err = skip_segment(source, len);
+				RETURN_IF(err);
+				break;
+			default:
+				msg_error("unhandled marker 0x%" PRIx16 "\n", marker);
+				return RET_FAILURE_FILE_UNSUPPORTED;
+		}
+	}
+}
+
+int read_coefficients(struct source *source, struct context *context)
+{
+	assert(context != NULL);
+
+	context->sparse = 1;
+	context->pipelined = 0;
+
+	return parse_format(source, context, NULL);
+}
+
+int process_jpeg_source(struct source *source, const struct decoder_output *output, const struct decoder_params *params)
+{
+	int err;
+
+	struct context *context = mem_malloc(MEM_OTHER, sizeof(struct context));
+
+	if (context == NULL) {
+		msg_error("malloc failure\n");
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	PROBE1(image__start, "decoder");
+
+	err = init_context(context);
+
+	if (err) {
+		goto end;
+	}
+
+	if (params->arena != NULL) {
+		context->arena = params->arena;
+	} else {
+		err = arena_create(&context->arena);
+
+		if (err) {
+			goto end;
+		}
+	}
+
+	context->layout = params->layout;
+	context->pipelined = params->pipelined;
+	context->stats = params->stats;
+	context->analysis = params->analysis;
+
+	if (params->threads > 1) {
+		err = pool_create(&context->pool, params->threads);
+
+		if (err) {
+			goto end;
+		}
+	}
+
+	stats_stage(context->stats, STAGE_MARKERS);
+
+	err = parse_format(source, context, output);
+
+	stats_stop(context->stats);
+	stats_count(context->stats, context);
+
+	if (context->stats != NULL) {
+		context->stats->bytes_in = source_tell(source);
+	}
+end:
+	PROBE4(image__done, "decoder", err, context->X, context->Y);
+
+	pipeline_destroy(context);
+
+	pool_destroy(context->pool);
+
+	free_buffers(context);
+
+	/* the caller's arena is kept for the next image */
+	if (params->arena != NULL) {
+		arena_reset(params->arena);
+	} else {
+		arena_destroy(context->arena);
+	}
+
+	mem_free(MEM_OTHER, context);
+
+	return err;
+}
+
+int process_jpeg_file(const char *i_path, const char *o_path, const struct decoder_params *params)
+{
+	struct source source;
+
+	int err = source_open(&source, i_path);
+
+	if (err) {
+		msg_error("open failure\n");
+		return err;
+	}
+
+	struct decoder_output output = { o_path, NULL };
+
+	err = process_jpeg_source(&source, &output, params);
+
+	source_close(&source);
+
+	return err;
+}
@@ -0,0 +1,47 @@
+#ifndef JPEG_DECODE_H
+#define JPEG_DECODE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "source.h"
+#include "arena.h"
+
+struct decoder_params {
+	/* coefficient layout */
+	uint8_t layout;
+
+	/* number of threads */
+	int threads;
+
+	/* reconstruct MCU rows while decoding the entropy-coded data */
+	uint8_t pipelined;
+
+	/* buffers reused across images, NULL = private to the call */
+	struct arena *arena;
+
+	/* stage timings, NULL = not collected */
+	struct stats *stats;
+
+	/* bitstream statistics, NULL = not collected */
+	struct analysis *analysis;
+};
+
+void init_decoder_params(struct decoder_params *params);
+
+/* where the decoded image is written to */
+struct decoder_output {
+	/* PNM file, NULL = output.ppm or output.pgm, "-" = standard output */
+	const char *path;
+
+	/* if not NULL, the PNM image is written into this stream instead */
+	FILE *stream;
+};
+
+/* parse the codestream into the sparse store of the context, the image is not reconstructed */
+int read_coefficients(struct source *source, struct context *context);
+
+int process_jpeg_source(struct source *source, const struct decoder_output *output, const struct decoder_params *params);
+
+int process_jpeg_file(const char *i_path, const char *o_path, const struct decoder_params *params);
+
+#endif
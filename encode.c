@@ -0,0 +1,1458 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include "common.h"
+#include "frame.h"
+#include "coeffs.h"
+#include "imgproc.h"
+#include "huffman.h"
+#include "pool.h"
+#include "source.h"
+#include "mem.h"
+#include "stats.h"
+#include "probes.h"
+#include "decode.h"
+#include "encode.h"
+
+/* K.1 Quantization tables for luminance and chrominance components */
+static const unsigned int std_luminance_quant_tbl[64] = {
+  16,  11,  10,  16,  24,  40,  51,  61,
+  12,  12,  14,  19,  26,  58,  60,  55,
+  14,  13,  16,  24,  40,  57,  69,  56,
+  14,  17,  22,  29,  51,  87,  80,  62,
+  18,  22,  37,  56,  68, 109, 103,  77,
+  24,  35,  55,  64,  81, 104, 113,  92,
+  49,  64,  78,  87, 103, 121, 120, 101,
+  72,  92,  95,  98, 112, 100, 103,  99
+};
+
+static const unsigned int std_chrominance_quant_tbl[64] = {
+  17,  18,  24,  47,  99,  99,  99,  99,
+  18,  21,  26,  66,  99,  99,  99,  99,
+  24,  26,  56,  99,  99,  99,  99,  99,
+  47,  66,  99,  99,  99,  99,  99,  99,
+  99,  99,  99,  99,  99,  99,  99,  99,
+  99,  99,  99,  99,  99,  99,  99,  99,
+  99,  99,  99,  99,  99,  99,  99,  99,
+  99,  99,  99,  99,  99,  99,  99,  99
+};
+
+/* 0..100 to scaling_factor */
+/* according to https://github.com/libjpeg-turbo/ijg/blob/master/jcparam.c */
+int quality_to_sf(int q)
+{
+	if (q < 1) {
+		q = 1;
+	}
+	if (q > 100) {
+		q = 100;
+	}
+
+	int sf;
+
+	if (q < 50) {
+		sf = 5000 / q;
+	} else {
+		sf = 200 - q * 2;
+	}
+
+	return sf;
+}
+
+void set_qtable(struct qtable *qtable, const unsigned int Q_ref[64], int q)
+{
+	int sf = quality_to_sf(q);
+
+	for (int i = 0; i < 64; ++i) {
+		qtable->Q[i] = clamp(1, (Q_ref[i] * sf + 50) / 100, 255);
+	}
+}
+
+void set_std_qtable(struct qtable *qtable, int chrominance, int q)
+{
+	set_qtable(qtable, chrominance ? std_chrominance_quant_tbl : std_luminance_quant_tbl, q);
+}
+
+void init_encoder_params(struct encoder_params *params)
+{
+	assert(params != NULL);
+
+	params->H = 2;
+	params->V = 1;
+
+	params->q = 75;
+
+	params->optimize = 1;
+
+	params->layout = LAYOUT_RASTER;
+
+	params->threads = 1;
+
+	params->pipelined = 0;
+
+	params->restart = 0;
+
+	params->arena = NULL;
+
+	params->stats = NULL;
+
+	params->analysis = NULL;
+
+	params->raw = 0;
+}
+
+/* read the image into the frame, unless pipelined, convert it into the components */
+int read_image(struct context *context, struct source *source, const struct encoder_params *params, struct frame *frame)
+{
+	int err;
+
+	assert(context != NULL);
+	assert(frame != NULL);
+
+	stats_stage(context->stats, STAGE_PNM);
+
+	if (params->raw) {
+		frame->components = params->components;
+		frame->Y = params->Y;
+		frame->X = params->X;
+		frame->precision = params->precision;
+	} else {
+		// load PPM/PGM header, detect X, Y, number of components, bpp
+		err = read_frame_header(frame, source);
+		RETURN_IF(err);
+	}
+
+	msg_info("read PPM/PGM header: Nf=%" PRIu8 " Y=%" PRIu16 " X=%" PRIu16 " P=%" PRIu8 "\n", frame->components, frame->Y, frame->X, frame->precision);
+
+	context->Y = frame->Y;
+	context->X = frame->X;
+	context->P = frame->precision;
+	context->kernels = select_kernels(frame->precision);
+
+	err = alloc_components(context, frame->components);
+	RETURN_IF(err);
+
+	/* identifiers 1, 2, 3 */
+	for (int i = 0; i < context->Nf; ++i) {
+		context->component[i].C = (uint8_t)(i + 1);
+	}
+
+	switch (frame->components) {
+		case 1:
+			context->component[0].H = 1;
+			context->component[0].V = 1;
+
+			context->component[0].Tq = 0;
+
+			context->component[0].Td = 0;
+			context->component[0].Ta = 0;
+
+			context->max_H = 1;
+			context->max_V = 1;
+			break;
+		case 3:
+			assert(params->H >= 1 && params->H <= 2);
+			assert(params->V >= 1 && params->V <= 2);
+
+			context->component[0].H = params->H;
+			context->component[0].V = params->V;
+			context->component[1].H = 1;
+			context->component[1].V = 1;
+			context->component[2].H = 1;
+			context->component[2].V = 1;
+
+			context->component[0].Tq = 0;
+			context->component[1].Tq = 1;
+			context->component[2].Tq = 1;
+
+			context->component[0].Td = 0;
+			context->component[0].Ta = 0;
+			context->component[1].Td = 1;
+			context->component[1].Ta = 1;
+			context->component[2].Td = 1;
+			context->component[2].Ta = 1;
+
+			context->max_H = params->H;
+			context->max_V = params->V;
+			break;
+		default:
+			return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	set_std_qtable(&context->qtable[0], 0, params->q);
+	set_std_qtable(&context->qtable[1], 1, params->q);
+
+	err = frame_create_empty(context, frame);
+	RETURN_IF(err);
+
+	// load frame body
+	err = read_frame_body(frame, source);
+	RETURN_IF(err);
+
+	err = compute_no_blocks_and_alloc_buffers(context);
+	RETURN_IF(err);
+
+	/* the transform pipeline converts the frame row by row */
+	if (context->pipelined) {
+		return RET_SUCCESS;
+	}
+
+	stats_stage(context->stats, STAGE_COLOR);
+
+	err = frame_to_ycc(frame);
+	RETURN_IF(err);
+
+	stats_stage(context->stats, STAGE_SAMPLING);
+
+	// copy frame->data[] into context->component[]->frame_buffer[]
+	transform_frame_to_components(context, frame);
+
+	frame_destroy(frame);
+	frame->data = NULL;
+
+	return RET_SUCCESS;
+}
+
+/* read_image(), conv_frame_to_blocks(), forward_dct(), quantize() */
+int prologue(struct context *context, struct source *source, const struct encoder_params *params, struct frame *frame)
+{
+	int err;
+
+	err = read_image(context, source, params, frame);
+	RETURN_IF(err);
+
+	if (context->pipelined) {
+		return RET_SUCCESS;
+	}
+
+	stats_stage(context->stats, STAGE_BLOCKS);
+
+	err = conv_frame_to_blocks(context);
+	RETURN_IF(err);
+
+	stats_stage(context->stats, STAGE_DCT);
+
+	err = forward_dct(context);
+	RETURN_IF(err);
+
+	stats_stage(context->stats, STAGE_QUANTIZATION);
+
+	err = quantize(context);
+	RETURN_IF(err);
+
+	return RET_SUCCESS;
+}
+
+int produce_SOI(FILE *stream)
+{
+	int err;
+
+	err = write_marker(stream, 0xffd8);
+	RETURN_IF(err);
+
+	return RET_SUCCESS;
+}
+
+int produce_DQT(struct context *context, uint8_t Tq, FILE *stream)
+{
+	int err;
+
+	assert(context != NULL);
+
+	err = write_marker(stream, 0xffdb);
+	RETURN_IF(err);
+
+	struct qtable *qtable = &context->qtable[Tq];
+
+	uint8_t Pq = qtable->Pq;
+
+	// length = 2 (len) + 1 (Pq, Tq) + 64 (Q[]) = 67, or 131 with 16-bit Q[]
+	err = write_length(stream, 3 + 64 * (Pq + 1));
+	RETURN_IF(err);
+
+	err = write_nibbles(stream, Pq, Tq);
+	RETURN_IF(err);
+
+	for (int i = 0; i < 64; ++i) {
+		if (Pq == 0) {
+			err = write_byte(stream, (uint8_t)qtable->Q[zigzag[i]]);
+		} else {
+			err = write_word(stream, qtable->Q[zigzag[i]]);
+		}
+		RETURN_IF(err);
+	}
+
+	return RET_SUCCESS;
+}
+
+int produce_SOF0(struct context *context, FILE *stream)
+{
+	int err;
+
+	assert(context != NULL);
+
+	err = write_marker(stream, 0xffc0);
+	RETURN_IF(err);
+
+	uint8_t Nf = context->Nf;
+
+	// length = 2 (len) + 1 (P) + 2 (Y) + 2 (X) + 1 (Nf) + Nf * ( 1 (C) + 1 (H, V) + 1 (Tq) ) = 8 + 3 * Nf
+	err = write_length(stream, 8 + 3 * Nf);
+	RETURN_IF(err);
+
+	err = write_byte(stream, context->P);
+	RETURN_IF(err);
+	err = write_word(stream, context->Y);
+	RETURN_IF(err);
+	err = write_word(stream, context->X);
+	RETURN_IF(err);
+	err = write_byte(stream, context->Nf);
+	RETURN_IF(err);
+
+	for (int i = 0; i < Nf; ++i) {
+		err = write_byte(stream, context->component[i].C);
+		RETURN_IF(err);
+
+		err = write_nibbles(stream, context->component[i].H, context->component[i].V);
+		RETURN_IF(err);
+
+		err = write_byte(stream, context->component[i].Tq);
+		RETURN_IF(err);
+	}
+
+	return RET_SUCCESS;
+}
+
+int produce_DHT(struct context *context, uint8_t Tc, uint8_t Th, FILE *stream)
+{
+	int err;
+
+	assert(context != NULL);
+
+	err = write_marker(stream, 0xffc4);
+	RETURN_IF(err);
+
+	struct htable *htable = &context->htable[Tc][Th];
+
+	// compute "mt (V)"
+	uint16_t mt = 0;
+	for (int i = 0; i < 16; ++i) {
+		uint8_t L = htable->L[i];
+		mt += L;
+	}
+
+	// length = 2 (len) + 1 (Tc, Th) + 16 * 1 (L) + mt (V) = 2 + 17 + mt (V)
+	err = write_length(stream, 2 + 17 + mt);
+	RETURN_IF(err);
+
+	err = write_nibbles(stream, Tc, Th);
+	RETURN_IF(err);
+
+	for (int i = 0; i < 16; ++i) {
+		err = write_byte(stream, htable->L[i]);
+		RETURN_IF(err);
+	}
+
+	for (int k = 0; k < mt; ++k) {
+		err = write_byte(stream, htable->V[k]);
+		RETURN_IF(err);
+	}
+
+	return RET_SUCCESS;
+}
+
+/* tokens of the macroblocks [begin, end) */
+struct segment {
+	size_t begin, end;
+
+	struct token *token;
+	size_t tokens;
+	size_t token_size;
+
+	/* private histograms */
+	struct huffenc huffenc[2][4];
+
+	int err;
+};
+
+struct scan {
+	uint8_t Ns;
+	uint8_t Cs[256];
+
+	/* useful to remove differential DC coding
+	 *
+	 * At the beginning of the scan and at the beginning of each restart interval, the prediction for the DC coefficient prediction
+	 * is initialized to 0. */
+	struct int_block *last_block[256];
+
+	/* MCU rows being transformed concurrently, or NULL */
+	struct transform_pipeline *pipeline;
+
+	/* coded values collected by tokenize_ecs(), or NULL */
+	struct segment *segment;
+	int segments;
+	/* the next token to be written */
+	int next_segment;
+	size_t next_token;
+};
+
+int fill_scan(struct context *context, struct scan *scan)
+{
+	assert(context != NULL);
+	assert(scan != NULL);
+
+	scan->Ns = context->Nf;
+
+	for (int j = 0; j < scan->Ns; ++j) {
+		scan->Cs[j] = j;
+	}
+
+	return RET_SUCCESS;
+}
+
+int produce_SOS(struct context *context, FILE *stream, struct scan *scan)
+{
+	int err;
+
+	assert(context != NULL);
+	assert(scan != NULL);
+
+	err = write_marker(stream, 0xffda);
+	RETURN_IF(err);
+
+	uint8_t Ns = context->Nf;
+
+	/* Number of image components in scan = Number of image components in frame */
+	scan->Ns = Ns;
+
+	// length = 2 (len) + 1 (Ns) + Ns * (1 (Cs) + 1 (Td, Ta)) + 1 (Ss) + 1 (Se) + 1 (Ah, Al) = 6 + 2 * Ns
+	err = write_length(stream, 6 + 2 * Ns);
+	RETURN_IF(err);
+
+	for (int j = 0; j < scan->Ns; ++j) {
+		scan->Cs[j] = j;
+	}
+
+	err = write_byte(stream, Ns);
+	RETURN_IF(err);
+
+	for (int j = 0; j < Ns; ++j) {
+		uint8_t Cs;
+		uint8_t Td, Ta;
+
+		Cs = scan->Cs[j];
+		Td = context->component[Cs].Td;
+		Ta = context->component[Cs].Ta;
+
+		err = write_byte(stream, context->component[Cs].C);
+		RETURN_IF(err);
+
+		err = write_nibbles(stream, Td, Ta);
+		RETURN_IF(err);
+	}
+
+	uint8_t Ss = 0;
+	uint8_t Se = 63;
+	uint8_t Ah = 0, Al = 0;
+
+	err = write_byte(stream, Ss);
+	RETURN_IF(err);
+	err = write_byte(stream, Se);
+	RETURN_IF(err);
+	err = write_nibbles(stream, Ah, Al);
+	RETURN_IF(err);
+
+	return RET_SUCCESS;
+}
+
+int produce_DRI(struct context *context, FILE *stream)
+{
+	int err;
+
+	assert(context != NULL);
+
+	err = write_marker(stream, 0xffdd);
+	RETURN_IF(err);
+
+	// length = 2 (len) + 2 (Ri) = 4
+	err = write_length(stream, 4);
+	RETURN_IF(err);
+
+	err = write_word(stream, context->Ri);
+	RETURN_IF(err);
+
+	return RET_SUCCESS;
+}
+
+/* the DC prediction is reset at the MCU */
+static int restart_at(const struct context *context, size_t seq_no)
+{
+	return context->Ri != 0 && seq_no % context->Ri == 0;
+}
+
+int produce_EOI(FILE *stream)
+{
+	int err;
+
+	err = write_marker(stream, 0xffd9);
+	RETURN_IF(err);
+
+	return RET_SUCCESS;
+}
+
+/*
+ * Transform stages running ahead of the entropy coder.
+ *
+ * The worker threads claim MCU rows in order, convert them to YCbCr,
+ * downsample, run the FDCT and quantize them, and then raise the ready
+ * flag of the row. The entropy coder waits for the flag before coding the
+ * first MCU of each row, it polls a few times and then sleeps until a
+ * worker signals a finished row.
+ */
+
+/* the polls before the entropy coder goes to sleep */
+#define TRANSFORM_SPIN 64
+
+struct transform_pipeline {
+	struct context *context;
+	struct frame *frame;
+
+	/* number of MCU rows */
+	size_t rows;
+	/* next row to be claimed */
+	size_t next;
+	/* per-row ready flags */
+	uint8_t *ready;
+
+	int threads;
+	pthread_t *thread;
+
+	/* the entropy coder sleeps */
+	int waiting;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+static void transform_row(struct transform_pipeline *pipeline, size_t row)
+{
+	struct context *context = pipeline->context;
+	struct frame *frame = pipeline->frame;
+
+	size_t y0 = row * context->max_V * 8;
+	size_t y1 = y0 + context->max_V * 8;
+
+	/* the padding is not converted */
+	if (y1 > frame->Y) {
+		y1 = frame->Y;
+	}
+
+	if (y0 < y1) {
+		frame_to_ycc_rows(frame, y0, y1);
+	}
+
+	// component id
+	int compno = 0;
+
+	for (int i = 0; i < context->Nf; ++i) {
+		struct component *component = &context->component[i];
+
+		if (component->frame_buffer != NULL) {
+			size_t V = component->V;
+			size_t b_x = component->b_x;
+
+			/* the row occupies consecutive blocks in any layout */
+			size_t begin = row * V * b_x;
+			size_t end = (row + 1) * V * b_x;
+
+			transform_frame_to_component_rows(component, compno, frame, row * V * 8, (row + 1) * V * 8);
+			conv_frame_to_blocks_rows(context, component, row * V, (row + 1) * V);
+			forward_dct_blocks(context, component, begin, end);
+			quantize_blocks(context, component, begin, end);
+
+			compno++;
+		}
+	}
+}
+
+static void *transform_worker(void *arg)
+{
+	struct transform_pipeline *pipeline = arg;
+
+	while (1) {
+		size_t row = __atomic_fetch_add(&pipeline->next, 1, __ATOMIC_RELAXED);
+
+		if (row >= pipeline->rows) {
+			break;
+		}
+
+		transform_row(pipeline, row);
+
+		__atomic_store_n(&pipeline->ready[row], 1, __ATOMIC_SEQ_CST);
+
+		/* see transform_pipeline_wait() */
+		if (__atomic_load_n(&pipeline->waiting, __ATOMIC_SEQ_CST)) {
+			pthread_mutex_lock(&pipeline->mutex);
+			pthread_cond_signal(&pipeline->cond);
+			pthread_mutex_unlock(&pipeline->mutex);
+		}
+	}
+
+	return NULL;
+}
+
+/* wait for the workers to transform all rows */
+void transform_pipeline_destroy(struct transform_pipeline *pipeline)
+{
+	if (pipeline == NULL) {
+		return;
+	}
+
+	for (int i = 0; i < pipeline->threads; ++i) {
+		pthread_join(pipeline->thread[i], NULL);
+	}
+
+	pthread_cond_destroy(&pipeline->cond);
+	pthread_mutex_destroy(&pipeline->mutex);
+
+	mem_free(MEM_OTHER, pipeline->thread);
+	mem_free(MEM_OTHER, pipeline->ready);
+	mem_free(MEM_OTHER, pipeline);
+}
+
+int transform_pipeline_create(struct transform_pipeline **pipeline_, struct context *context, struct frame *frame)
+{
+	assert(pipeline_ != NULL);
+	assert(context != NULL);
+	assert(frame != NULL);
+
+	struct transform_pipeline *pipeline = mem_malloc(MEM_OTHER, sizeof(struct transform_pipeline));
+
+	if (pipeline == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	pipeline->context = context;
+	pipeline->frame = frame;
+	pipeline->rows = context->m_y;
+	pipeline->next = 0;
+	pipeline->threads = pool_threads(context->pool);
+
+	pipeline->ready = mem_calloc(MEM_OTHER, sizeof(uint8_t) * pipeline->rows);
+	pipeline->thread = mem_malloc(MEM_OTHER, sizeof(pthread_t) * pipeline->threads);
+
+	if (pipeline->ready == NULL || pipeline->thread == NULL) {
+		mem_free(MEM_OTHER, pipeline->ready);
+		mem_free(MEM_OTHER, pipeline->thread);
+		mem_free(MEM_OTHER, pipeline);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	pipeline->waiting = 0;
+	pthread_mutex_init(&pipeline->mutex, NULL);
+	pthread_cond_init(&pipeline->cond, NULL);
+
+	for (int i = 0; i < pipeline->threads; ++i) {
+		if (pthread_create(&pipeline->thread[i], NULL, transform_worker, pipeline) != 0) {
+			/* let the running workers finish the job */
+			pipeline->threads = i;
+			break;
+		}
+	}
+
+	if (pipeline->threads == 0) {
+		pthread_cond_destroy(&pipeline->cond);
+		pthread_mutex_destroy(&pipeline->mutex);
+		mem_free(MEM_OTHER, pipeline->ready);
+		mem_free(MEM_OTHER, pipeline->thread);
+		mem_free(MEM_OTHER, pipeline);
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	msg_debug("Pipelined transform with %i threads\n", pipeline->threads);
+
+	*pipeline_ = pipeline;
+
+	return RET_SUCCESS;
+}
+
+/* wait until the MCU row is transformed */
+void transform_pipeline_wait(struct transform_pipeline *pipeline, size_t row)
+{
+	if (pipeline == NULL) {
+		return;
+	}
+
+	assert(row < pipeline->rows);
+
+	for (int spin = 0; spin < TRANSFORM_SPIN; ++spin) {
+		if (__atomic_load_n(&pipeline->ready[row], __ATOMIC_ACQUIRE)) {
+			return;
+		}
+
+		sched_yield();
+	}
+
+	/*
+	 * The flag is checked again under the lock after the waiting is
+	 * announced, the worker raises the flag before it reads the waiting
+	 * (both sequentially consistent). So either the flag is seen here, or
+	 * the worker signals under the lock.
+	 */
+	pthread_mutex_lock(&pipeline->mutex);
+	__atomic_store_n(&pipeline->waiting, 1, __ATOMIC_SEQ_CST);
+
+	while (__atomic_load_n(&pipeline->ready[row], __ATOMIC_SEQ_CST) == 0) {
+		pthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+	}
+
+	__atomic_store_n(&pipeline->waiting, 0, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&pipeline->mutex);
+}
+
+int write_macroblock(struct bits *bits, struct context *context, struct scan *scan)
+{
+	int err;
+
+	assert(scan != NULL);
+	assert(context != NULL);
+
+	size_t seq_no = context->mblocks;
+
+	size_t x = seq_no % context->m_x;
+	size_t y = seq_no / context->m_x;
+
+	/* for each component */
+	for (int j = 0; j < scan->Ns; ++j) {
+		uint8_t Cs = scan->Cs[j];
+		uint8_t H = context->component[Cs].H;
+		uint8_t V = context->component[Cs].V;
+
+		/* for each 8x8 block */
+		for (int v = 0; v < V; ++v) {
+			for (int h = 0; h < H; ++h) {
+				size_t block_x = x * H + h;
+				size_t block_y = y * V + v;
+
+				assert(block_x < context->component[Cs].b_x);
+
+				size_t block_seq = block_index(context, &context->component[Cs], block_x, block_y);
+
+				struct int_block *int_block = &context->component[Cs].int_buffer[block_seq];
+
+				/* differential DC coding */
+				if (scan->last_block[Cs] != NULL) {
+					int_block->c[0] -= scan->last_block[Cs]->c[0];
+				}
+
+				assert(int_block->c[0] >= -32767 && int_block->c[0] <= +32767);
+
+				/* write block */
+				err = write_block(bits, context, Cs, int_block);
+				RETURN_IF(err);
+
+				// revert back
+				if (scan->last_block[Cs] != NULL) {
+					int_block->c[0] += scan->last_block[Cs]->c[0];
+				}
+
+				scan->last_block[Cs] = int_block;
+			}
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+/* quantized DC coefficient of the block, from either store */
+static int32_t block_dc(const struct component *component, size_t block_seq)
+{
+	if (component->sparse != NULL) {
+		return sparse_dc(component->sparse, block_seq);
+	}
+
+	return component->int_buffer[block_seq].c[0];
+}
+
+/* make room for the tokens of one more block */
+int reserve_tokens(struct segment *segment)
+{
+	assert(segment != NULL);
+
+	if (segment->tokens + MAX_BLOCK_TOKENS > segment->token_size) {
+		size_t size = segment->token_size * 2;
+
+		if (size < segment->tokens + MAX_BLOCK_TOKENS) {
+			size = segment->tokens + MAX_BLOCK_TOKENS;
+		}
+
+		struct token *token = mem_realloc(MEM_TOKENS, segment->token, sizeof(struct token) * size);
+
+		if (token == NULL) {
+			return RET_FAILURE_MEMORY_ALLOCATION;
+		}
+
+		segment->token = token;
+		segment->token_size = size;
+	}
+
+	return RET_SUCCESS;
+}
+
+/* pred[] holds the DC prediction of each component */
+int tokenize_macroblock(struct context *context, struct scan *scan, struct segment *segment, size_t seq_no, int32_t pred[256])
+{
+	int err;
+
+	assert(scan != NULL);
+	assert(context != NULL);
+	assert(segment != NULL);
+
+	size_t x = seq_no % context->m_x;
+	size_t y = seq_no / context->m_x;
+
+	/* for each component */
+	for (int j = 0; j < scan->Ns; ++j) {
+		uint8_t Cs = scan->Cs[j];
+		uint8_t H = context->component[Cs].H;
+		uint8_t V = context->component[Cs].V;
+		uint8_t Td = context->component[Cs].Td;
+		uint8_t Ta = context->component[Cs].Ta;
+
+		/* for each 8x8 block */
+		for (int v = 0; v < V; ++v) {
+			for (int h = 0; h < H; ++h) {
+				size_t block_x = x * H + h;
+				size_t block_y = y * V + v;
+
+				assert(block_x < context->component[Cs].b_x);
+
+				size_t block_seq = block_index(context, &context->component[Cs], block_x, block_y);
+
+				err = reserve_tokens(segment);
+				RETURN_IF(err);
+
+				struct token *token = segment->token + segment->tokens;
+				struct sparse *sparse = context->component[Cs].sparse;
+
+				if (sparse != NULL) {
+					segment->tokens += tokenize_sparse_block(sparse, block_seq, pred[Cs], &segment->huffenc[0][Td], &segment->huffenc[1][Ta], token);
+				} else {
+					segment->tokens += tokenize_block(context->kernels, &context->component[Cs].int_buffer[block_seq], pred[Cs], &segment->huffenc[0][Td], &segment->huffenc[1][Ta], token);
+				}
+
+				pred[Cs] = block_dc(&context->component[Cs], block_seq);
+			}
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+int tokenize_segment(struct context *context, struct scan *scan, struct segment *segment)
+{
+	int err;
+
+	assert(context != NULL);
+	assert(scan != NULL);
+	assert(segment != NULL);
+
+	size_t m_x = context->m_x;
+
+	int32_t pred[256];
+
+	for (int j = 0; j < scan->Ns; ++j) {
+		pred[scan->Cs[j]] = 0;
+	}
+
+	/* the DC prediction comes from the last blocks of the preceding MCU */
+	if (segment->begin > 0 && !restart_at(context, segment->begin)) {
+		size_t seq_no = segment->begin - 1;
+
+		size_t x = seq_no % m_x;
+		size_t y = seq_no / m_x;
+
+		transform_pipeline_wait(scan->pipeline, y);
+
+		for (int j = 0; j < scan->Ns; ++j) {
+			struct component *component = &context->component[scan->Cs[j]];
+
+			size_t block_x = x * component->H + component->H - 1;
+			size_t block_y = y * component->V + component->V - 1;
+
+			pred[scan->Cs[j]] = block_dc(component, block_index(context, component, block_x, block_y));
+		}
+	}
+
+	/* loop over macroblocks */
+	for (size_t seq_no = segment->begin; seq_no < segment->end; ++seq_no) {
+		if (seq_no % m_x == 0) {
+			transform_pipeline_wait(scan->pipeline, seq_no / m_x);
+		}
+
+		if (restart_at(context, seq_no)) {
+			for (int j = 0; j < scan->Ns; ++j) {
+				pred[scan->Cs[j]] = 0;
+			}
+		}
+
+		err = tokenize_macroblock(context, scan, segment, seq_no, pred);
+		RETURN_IF(err);
+	}
+
+	return RET_SUCCESS;
+}
+
+struct tokenize_job {
+	struct context *context;
+	struct scan *scan;
+};
+
+static void tokenize_band(void *arg, size_t begin, size_t end)
+{
+	struct tokenize_job *job = arg;
+
+	for (size_t i = begin; i < end; ++i) {
+		struct segment *segment = &job->scan->segment[i];
+
+		segment->err = tokenize_segment(job->context, job->scan, segment);
+	}
+}
+
+void free_segments(struct scan *scan)
+{
+	assert(scan != NULL);
+
+	if (scan->segment == NULL) {
+		return;
+	}
+
+	for (int i = 0; i < scan->segments; ++i) {
+		mem_free(MEM_TOKENS, scan->segment[i].token);
+	}
+
+	mem_free(MEM_TOKENS, scan->segment);
+
+	scan->segment = NULL;
+	scan->segments = 0;
+}
+
+/* replay the tokens of the macroblock */
+int write_macroblock_tokens(struct bits *bits, struct context *context, struct scan *scan)
+{
+	int err;
+
+	assert(scan != NULL);
+	assert(context != NULL);
+
+	/* move to the segment containing this macroblock */
+	while (context->mblocks >= scan->segment[scan->next_segment].end) {
+		scan->next_segment++;
+		scan->next_token = 0;
+
+		assert(scan->next_segment < scan->segments);
+	}
+
+	struct segment *segment = &scan->segment[scan->next_segment];
+
+	/* for each component */
+	for (int j = 0; j < scan->Ns; ++j) {
+		uint8_t Cs = scan->Cs[j];
+		uint8_t H = context->component[Cs].H;
+		uint8_t V = context->component[Cs].V;
+
+		/* for each 8x8 block */
+		for (int b = 0; b < H * V; ++b) {
+			size_t count;
+
+			assert(scan->next_token < segment->tokens);
+
+			err = write_block_tokens(bits, context, Cs, segment->token + scan->next_token, &count);
+			RETURN_IF(err);
+
+			scan->next_token += count;
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+static const char *const Tc_to_str[] = {
+	[0] = "DC",
+	[1] = "AC"
+};
+
+/*
+ * Code the scan into tokens and collect their frequencies, then adapt the
+ * Huffman tables. The write_ecs() then replays the tokens without scanning
+ * the coefficients again.
+ *
+ * The scan is split into segments of whole MCU rows, one per thread. Each
+ * segment has its own tokens and histograms, the histograms are summed up
+ * before adapting the tables.
+ */
+int tokenize_ecs(struct context *context, struct scan *scan, int method)
+{
+	int err;
+
+	size_t segments = (size_t)pool_threads(context->pool);
+
+	if (segments > context->m_y) {
+		segments = context->m_y;
+	}
+
+	scan->segment = mem_malloc(MEM_TOKENS, sizeof(struct segment) * segments);
+
+	if (scan->segment == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	scan->segments = (int)segments;
+
+	/* a rough guess, grown on demand */
+	size_t token_size = 0;
+	for (int j = 0; j < scan->Ns; ++j) {
+		struct component *component = &context->component[scan->Cs[j]];
+
+		token_size += component->b_x * component->b_y * 8;
+	}
+
+	for (size_t i = 0; i < segments; ++i) {
+		struct segment *segment = &scan->segment[i];
+
+		segment->begin = context->m_y * i / segments * context->m_x;
+		segment->end = context->m_y * (i + 1) / segments * context->m_x;
+		segment->tokens = 0;
+		segment->token_size = token_size / segments;
+		segment->token = mem_malloc(MEM_TOKENS, sizeof(struct token) * segment->token_size);
+
+		if (segment->token == NULL) {
+			scan->segments = (int)i;
+			free_segments(scan);
+			return RET_FAILURE_MEMORY_ALLOCATION;
+		}
+
+		for (int j = 0; j < 2; ++j) {
+			for (int k = 0; k < 4; ++k) {
+				init_huffenc(&segment->huffenc[j][k]);
+			}
+		}
+	}
+
+	struct tokenize_job job = { context, scan };
+
+	pool_for(context->pool, segments, 1, tokenize_band, &job);
+
+	/* merge the histograms into the first segment */
+	struct huffenc (*huffenc)[4] = scan->segment[0].huffenc;
+
+	for (size_t i = 0; i < segments; ++i) {
+		struct segment *segment = &scan->segment[i];
+
+		RETURN_IF(segment->err);
+
+		if (i == 0) {
+			continue;
+		}
+
+		for (int j = 0; j < 2; ++j) {
+			for (int k = 0; k < 4; ++k) {
+				for (int v = 0; v < 256; ++v) {
+					huffenc[j][k].freq[v] += segment->huffenc[j][k].freq[v];
+				}
+			}
+		}
+	}
+
+	/* adapt codes */
+	for (int j = 0; j < 2; ++j) {
+		for (int i = 0; i < (context->Nf > 1 ? 2 : 1); ++i) {
+			msg_debug("Adapting Huffman table [%s][%i]...\n", Tc_to_str[j], i);
+
+			err = adapt_huffman_table(&context->htable[j][i], &huffenc[j][i], method);
+			RETURN_IF(err);
+
+			int err = conv_htable_to_hcode(&context->htable[j][i], &context->hcode[j][i]);
+			RETURN_IF(err);
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+int write_ecs(FILE *stream, struct context *context, struct scan *scan)
+{
+	int err;
+	struct bits bits;
+
+	init_bits(&bits, stream);
+
+	size_t mblocks_total = context->m_x * context->m_y;
+
+	/* reset the counter */
+	context->mblocks = 0;
+
+	for (int i = 0; i < 256; ++i) {
+		scan->last_block[i] = NULL;
+	}
+
+	scan->next_segment = 0;
+	scan->next_token = 0;
+
+	/* loop over macroblocks */
+	for (; context->mblocks < mblocks_total; context->mblocks++) {
+		/* RSTm, the count m runs modulo 8 */
+		if (context->mblocks > 0 && restart_at(context, context->mblocks)) {
+			err = flush_bits(&bits);
+			RETURN_IF(err);
+
+			err = write_marker(stream, 0xffd0 + (context->mblocks / context->Ri - 1) % 8);
+			RETURN_IF(err);
+
+			PROBE2(restart, (context->mblocks / context->Ri - 1) % 8, context->mblocks);
+
+			for (int i = 0; i < 256; ++i) {
+				scan->last_block[i] = NULL;
+			}
+		}
+
+		if (scan->segment != NULL) {
+			err = write_macroblock_tokens(&bits, context, scan);
+			RETURN_IF(err);
+			continue;
+		}
+
+		if (context->mblocks % context->m_x == 0) {
+			transform_pipeline_wait(scan->pipeline, context->mblocks / context->m_x);
+		}
+
+		err = write_macroblock(&bits, context, scan);
+		RETURN_IF(err);
+	}
+
+	flush_bits(&bits);
+
+	msg_debug("Processed: %zu macroblocks\n", context->mblocks);
+
+	return RET_SUCCESS;
+}
+
+/* unless the codestream is pipelined, the frame has already been transformed */
+int produce_codestream(struct context *context, FILE *stream, const struct encoder_params *params, struct frame *frame)
+{
+	int err;
+
+	stats_stage(context->stats, STAGE_MARKERS);
+
+	/* SOI */
+	err = produce_SOI(stream);
+	RETURN_IF(err);
+
+	/* DQT, each table used by the components once (Y, then Cb/Cr) */
+	unsigned written = 0;
+
+	for (int i = 0; i < context->Nf; ++i) {
+		uint8_t Tq = context->component[i].Tq;
+
+		if (written & (1U << Tq)) {
+			continue;
+		}
+
+		err = produce_DQT(context, Tq, stream);
+		RETURN_IF(err);
+
+		written |= 1U << Tq;
+	}
+
+	/* SOF0 */
+	err = produce_SOF0(context, stream);
+	RETURN_IF(err);
+
+	/* DRI */
+	if (context->Ri != 0) {
+		err = produce_DRI(context, stream);
+		RETURN_IF(err);
+	}
+
+	struct scan scan;
+
+	err = fill_scan(context, &scan);
+	RETURN_IF(err);
+
+	scan.pipeline = NULL;
+	scan.segment = NULL;
+	scan.segments = 0;
+
+	if (context->pipelined) {
+		err = transform_pipeline_create(&scan.pipeline, context, frame);
+		RETURN_IF(err);
+	}
+
+	// enable this by command line option
+	if (params->optimize) {
+		stats_stage(context->stats, STAGE_ENTROPY);
+
+		PROBE0(tokenize_ecs__start);
+		err = tokenize_ecs(context, &scan, params->optimize);
+		PROBE1(tokenize_ecs__done, err);
+
+		if (err) {
+			transform_pipeline_destroy(scan.pipeline);
+			free_segments(&scan);
+			return err;
+		}
+
+		/* all rows are transformed at this point */
+		transform_pipeline_destroy(scan.pipeline);
+		scan.pipeline = NULL;
+	}
+
+	stats_stage(context->stats, STAGE_MARKERS);
+
+	/* DHT */
+	err = produce_DHT(context, 0, 0, stream); // DC Y
+	if (err) {
+		goto end;
+	}
+	err = produce_DHT(context, 1, 0, stream); // AC Y
+	if (err) {
+		goto end;
+	}
+	if (context->Nf > 1) {
+		err = produce_DHT(context, 0, 1, stream); // DC Cb/Cr
+		if (err) {
+			goto end;
+		}
+		err = produce_DHT(context, 1, 1, stream); // AC Cb/Cr
+		if (err) {
+			goto end;
+		}
+	}
+
+	/* SOS */
+	err = produce_SOS(context, stream, &scan);
+	if (err) {
+		goto end;
+	}
+
+	/* loop over macroblocks */
+	stats_stage(context->stats, STAGE_ENTROPY);
+
+	PROBE0(write_ecs__start);
+	err = write_ecs(stream, context, &scan);
+	PROBE1(write_ecs__done, err);
+end:
+	transform_pipeline_destroy(scan.pipeline);
+	free_segments(&scan);
+	RETURN_IF(err);
+
+	stats_stage(context->stats, STAGE_MARKERS);
+
+	/* EOI */
+	err = produce_EOI(stream);
+	RETURN_IF(err);
+
+	return RET_SUCCESS;
+}
+
+/* the output position was start, -1 when the stream is not seekable */
+static void finish_stats(struct context *context, struct source *i_source, FILE *o_stream, long start)
+{
+	struct stats *stats = context->stats;
+
+	if (stats == NULL) {
+		return;
+	}
+
+	stats_stop(stats);
+	stats_count(stats, context);
+
+	stats->bytes_in = source_tell(i_source);
+
+	long end = ftell(o_stream);
+
+	stats->bytes_out = (start >= 0 && end >= 0) ? end - start : -1;
+}
+
+/*
+ * Lossless recompression of the JPEG codestream. The quantized coefficients
+ * are read into the sparse store and coded again with optimized Huffman
+ * tables, the image is not reconstructed.
+ */
+int process_coefficients(struct source *i_source, FILE *o_stream, const struct encoder_params *params)
+{
+	int err;
+
+	struct context *context = mem_malloc(MEM_OTHER, sizeof(struct context));
+
+	if (context == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	PROBE1(image__start, "encoder");
+
+	err = init_context(context);
+
+	if (err) {
+		goto end;
+	}
+
+	if (params->arena != NULL) {
+		context->arena = params->arena;
+	} else {
+		err = arena_create(&context->arena);
+
+		if (err) {
+			goto end;
+		}
+	}
+
+	context->layout = params->layout;
+	context->stats = params->stats;
+
+	if (params->threads > 1) {
+		err = pool_create(&context->pool, params->threads);
+
+		if (err) {
+			goto end;
+		}
+	}
+
+	long start = ftell(o_stream);
+
+	stats_stage(context->stats, STAGE_MARKERS);
+
+	err = read_coefficients(i_source, context);
+
+	if (err) {
+		goto end;
+	}
+
+	/* the scan written is interleaved, a single component must not be subsampled */
+	if (context->Nf == 0 || (context->Nf == 1 && (context->max_H != 1 || context->max_V != 1))) {
+		err = RET_FAILURE_FILE_UNSUPPORTED;
+		goto end;
+	}
+
+	/* the luma tables, then the chroma tables */
+	for (int i = 0; i < context->Nf; ++i) {
+		context->component[i].Td = (i == 0) ? 0 : 1;
+		context->component[i].Ta = (i == 0) ? 0 : 1;
+	}
+
+	struct encoder_params coeff_params = *params;
+
+	if (coeff_params.optimize == 0) {
+		coeff_params.optimize = HUFFMAN_ANNEX_K;
+	}
+
+	/* the restart interval of the input is not kept */
+	context->Ri = params->restart;
+
+	/* the symbols written, not those read */
+	context->analysis = params->analysis;
+
+	err = produce_codestream(context, o_stream, &coeff_params, NULL);
+
+	finish_stats(context, i_source, o_stream, start);
+end:
+	PROBE4(image__done, "encoder", err, context->X, context->Y);
+
+	pool_destroy(context->pool);
+
+	free_buffers(context);
+
+	/* the caller's arena is kept for the next image */
+	if (params->arena != NULL) {
+		arena_reset(params->arena);
+	} else {
+		arena_destroy(context->arena);
+	}
+
+	mem_free(MEM_OTHER, context);
+
+	return err;
+}
+
+int process_stream(struct source *i_source, FILE *o_stream, const struct encoder_params *params)
+{
+	int err;
+
+	struct context *context = mem_malloc(MEM_OTHER, sizeof(struct context));
+
+	if (context == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	PROBE1(image__start, "encoder");
+
+	struct frame frame;
+
+	frame.data = NULL;
+
+	err = init_context(context);
+
+	if (err) {
+		goto end;
+	}
+
+	if (params->arena != NULL) {
+		context->arena = params->arena;
+	} else {
+		err = arena_create(&context->arena);
+
+		if (err) {
+			goto end;
+		}
+	}
+
+	context->layout = params->layout;
+	context->pipelined = params->pipelined;
+	context->stats = params->stats;
+	context->analysis = params->analysis;
+	context->Ri = params->restart;
+
+	if (params->threads > 1) {
+		err = pool_create(&context->pool, params->threads);
+
+		if (err) {
+			goto end;
+		}
+	}
+
+	long start = ftell(o_stream);
+
+	err = prologue(context, i_source, params, &frame);
+
+	if (err) {
+		goto end;
+	}
+
+	err = produce_codestream(context, o_stream, params, &frame);
+
+	finish_stats(context, i_source, o_stream, start);
+end:
+	PROBE4(image__done, "encoder", err, context->X, context->Y);
+
+	frame_destroy(&frame);
+
+	pool_destroy(context->pool);
+
+	free_buffers(context);
+
+	/* the caller's arena is kept for the next image */
+	if (params->arena != NULL) {
+		arena_reset(params->arena);
+	} else {
+		arena_destroy(context->arena);
+	}
+
+	mem_free(MEM_OTHER, context);
+
+	return err;
+}
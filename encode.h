@@ -0,0 +1,60 @@
+#ifndef JPEG_ENCODE_H
+#define JPEG_ENCODE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "source.h"
+#include "arena.h"
+
+struct encoder_params {
+	/* luma subsampling */
+	uint8_t H, V;
+
+	/* quality 1..100 */
+	int q;
+
+	/* 0 = default Huffman tables, otherwise HUFFMAN_ANNEX_K or HUFFMAN_PACKAGE_MERGE */
+	int optimize;
+
+	/* coefficient layout */
+	uint8_t layout;
+
+	/* number of threads */
+	int threads;
+
+	/* transform MCU rows while entropy coding the previous ones */
+	uint8_t pipelined;
+
+	/* restart interval in MCUs, 0 = no restart markers */
+	uint16_t restart;
+
+	/* buffers reused across images, NULL = private to the call */
+	struct arena *arena;
+
+	/* stage timings, NULL = not collected */
+	struct stats *stats;
+
+	/* bitstream statistics, NULL = not collected */
+	struct analysis *analysis;
+
+	/* the input is a raw PNM raster of the format below, without the header */
+	uint8_t raw;
+	uint8_t components;
+	uint16_t Y, X;
+	uint8_t precision;
+};
+
+void init_encoder_params(struct encoder_params *params);
+
+struct qtable;
+
+/* the K.1 luminance or chrominance table scaled to the quality 1..100 */
+void set_std_qtable(struct qtable *qtable, int chrominance, int q);
+
+/* encode the PNM image from the source into the stream */
+int process_stream(struct source *i_source, FILE *o_stream, const struct encoder_params *params);
+
+/* recompress the JPEG codestream from the source with optimized Huffman tables, the coefficients are kept */
+int process_coefficients(struct source *i_source, FILE *o_stream, const struct encoder_params *params);
+
+#endif
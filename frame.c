@@ -2,15 +2,19 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <math.h>
-#include <arpa/inet.h>
 #include <ctype.h>
 #include "frame.h"
 #include "common.h"
+#include "pool.h"
+#include "source.h"
+#include "io.h"
+#include "arena.h"
+#include "mem.h"
 
+/* the data are released with the arena */
 void frame_destroy(struct frame *frame)
 {
-	free(frame->data);
+	frame->data = NULL;
 }
 
 int frame_create_empty(struct context *context, struct frame *frame)
@@ -24,8 +28,12 @@ int frame_create_empty(struct context *context, struct frame *frame)
 	frame->size_x = size_x;
 	frame->size_y = size_y;
 
+	frame->kernels = context->kernels;
+	frame->pool = context->pool;
+	frame->arena = context->arena;
+
 	// alloc frame->data[]
-	frame->data = malloc(sizeof(float) * frame->components * size_x * size_y);
+	frame->data = arena_alloc(frame->arena, MEM_FRAME, sizeof(float) * frame->components * size_x * size_y);
 
 	if (frame->data == NULL) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
@@ -34,104 +42,147 @@ int frame_create_empty(struct context *context, struct frame *frame)
 	return RET_SUCCESS;
 }
 
-// context->component[].frame_buffer[] => frame->data[]
-void transform_components_to_frame(struct context *context, struct frame *frame)
+/* component processed by a pool job */
+struct band {
+	struct component *component;
+	int compno;
+	struct frame *frame;
+};
+
+// component->frame_buffer[] rows [begin, end) => frame->data[]
+void transform_component_to_frame_rows(struct component *component, int compno, struct frame *frame, size_t begin, size_t end)
 {
-	assert(context != NULL);
+	assert(component != NULL);
 	assert(frame != NULL);
 
 	size_t size_x = frame->size_x;
 	size_t size_y = frame->size_y;
 
-	// component id
-	int compno = 0;
+	size_t b_x = component->b_x;
+	size_t b_y = component->b_y;
 
-	for (int i = 0; i < 256; ++i) {
-		if (context->component[i].frame_buffer != NULL) {
-			size_t b_x = context->component[i].b_x;
-			size_t b_y = context->component[i].b_y;
-
-			size_t c_x = b_x * 8;
-			size_t c_y = b_y * 8;
+	size_t c_x = b_x * 8;
+	size_t c_y = b_y * 8;
 
-			size_t step_x = size_x / c_x;
-			size_t step_y = size_y / c_y;
+	size_t step_x = size_x / c_x;
+	size_t step_y = size_y / c_y;
 
-			float *buffer = context->component[i].frame_buffer;
+	float *buffer = component->frame_buffer;
 
-			// iterate over component raster (smaller than frame raster)
-			for (size_t y = 0; y < c_y; ++y) {
-				for (size_t x = 0; x < c_x; ++x) {
-					// (i,y,x) to index component
-					// (compno,step*y,step*x) to index frame
+	// iterate over component raster (smaller than frame raster)
+	for (size_t y = begin; y < end; ++y) {
+		for (size_t x = 0; x < c_x; ++x) {
+			// (i,y,x) to index component
+			// (compno,step*y,step*x) to index frame
 
-					float px = buffer[y * c_x + x];
+			float px = buffer[y * c_x + x];
 
-					// copy patch
-					for (size_t yy = 0; yy < step_y; ++yy) {
-						for (size_t xx = 0; xx < step_x; ++xx) {
-							frame->data[(step_y * y + yy) * size_x * frame->components + frame->components * (step_x * x + xx) + compno] = px;
-						}
-					}
+			// copy patch
+			for (size_t yy = 0; yy < step_y; ++yy) {
+				for (size_t xx = 0; xx < step_x; ++xx) {
+					frame->data[(step_y * y + yy) * size_x * frame->components + frame->components * (step_x * x + xx) + compno] = px;
 				}
 			}
-
-			compno++;
 		}
 	}
 }
 
-void transform_frame_to_components(struct context *context, struct frame *frame)
+// frame->data[] => component->frame_buffer[] rows [begin, end)
+void transform_frame_to_component_rows(struct component *component, int compno, struct frame *frame, size_t begin, size_t end)
 {
-	assert(context != NULL);
+	assert(component != NULL);
 	assert(frame != NULL);
 
 	size_t size_x = frame->size_x;
 	size_t size_y = frame->size_y;
 
+	size_t b_x = component->b_x;
+	size_t b_y = component->b_y;
+
+	size_t c_x = b_x * 8;
+	size_t c_y = b_y * 8;
+
+	size_t step_x = size_x / c_x;
+	size_t step_y = size_y / c_y;
+
+	float *buffer = component->frame_buffer;
+
+	// iterate over component raster (smaller than frame raster)
+	for (size_t y = begin; y < end; ++y) {
+		for (size_t x = 0; x < c_x; ++x) {
+			// (i,y,x) to index component
+			// (compno,step*y,step*x) to index frame
+
+			float px = 0.f;
+
+			// copy patch
+			for (size_t yy = 0; yy < step_y; ++yy) {
+				for (size_t xx = 0; xx < step_x; ++xx) {
+					px += frame->data[(step_y * y + yy) * size_x * frame->components + frame->components * (step_x * x + xx) + compno];
+				}
+			}
+
+			px /= step_y * step_x;
+
+			buffer[y * c_x + x] = px;
+		}
+	}
+}
+
+static void transform_component_to_frame_band(void *arg, size_t begin, size_t end)
+{
+	struct band *band = arg;
+
+	transform_component_to_frame_rows(band->component, band->compno, band->frame, begin, end);
+}
+
+static void transform_frame_to_component_band(void *arg, size_t begin, size_t end)
+{
+	struct band *band = arg;
+
+	transform_frame_to_component_rows(band->component, band->compno, band->frame, begin, end);
+}
+
+// context->component[].frame_buffer[] => frame->data[]
+void transform_components_to_frame(struct context *context, struct frame *frame)
+{
+	assert(context != NULL);
+	assert(frame != NULL);
+
 	// component id
 	int compno = 0;
 
-	for (int i = 0; i < 256; ++i) {
+	for (int i = 0; i < context->Nf; ++i) {
 		if (context->component[i].frame_buffer != NULL) {
-			size_t b_x = context->component[i].b_x;
-			size_t b_y = context->component[i].b_y;
-
-			size_t c_x = b_x * 8;
-			size_t c_y = b_y * 8;
-
-			size_t step_x = size_x / c_x;
-			size_t step_y = size_y / c_y;
+			struct band band = { &context->component[i], compno, frame };
 
-			float *buffer = context->component[i].frame_buffer;
+			pool_for(frame->pool, context->component[i].b_y * 8, 8, transform_component_to_frame_band, &band);
 
-			// iterate over component raster (smaller than frame raster)
-			for (size_t y = 0; y < c_y; ++y) {
-				for (size_t x = 0; x < c_x; ++x) {
-					// (i,y,x) to index component
-					// (compno,step*y,step*x) to index frame
+			compno++;
+		}
+	}
+}
 
-					float px = 0.f;
+void transform_frame_to_components(struct context *context, struct frame *frame)
+{
+	assert(context != NULL);
+	assert(frame != NULL);
 
-					// copy patch
-					for (size_t yy = 0; yy < step_y; ++yy) {
-						for (size_t xx = 0; xx < step_x; ++xx) {
-							px += frame->data[(step_y * y + yy) * size_x * frame->components + frame->components * (step_x * x + xx) + compno];
-						}
-					}
+	// component id
+	int compno = 0;
 
-					px /= step_y * step_x;
+	for (int i = 0; i < context->Nf; ++i) {
+		if (context->component[i].frame_buffer != NULL) {
+			struct band band = { &context->component[i], compno, frame };
 
-					buffer[y * c_x + x] = px;
-				}
-			}
+			pool_for(frame->pool, context->component[i].b_y * 8, 8, transform_frame_to_component_band, &band);
 
 			compno++;
 		}
 	}
 }
 
-int frame_create(struct context *context, struct frame *frame)
+int frame_create_blank(struct context *context, struct frame *frame)
 {
 	assert(context != NULL);
 	assert(frame != NULL);
@@ -146,33 +197,34 @@ int frame_create(struct context *context, struct frame *frame)
 	err = frame_create_empty(context, frame);
 	RETURN_IF(err);
 
+	return RET_SUCCESS;
+}
+
+int frame_create(struct context *context, struct frame *frame)
+{
+	assert(context != NULL);
+	assert(frame != NULL);
+
+	int err;
+
+	err = frame_create_blank(context, frame);
+	RETURN_IF(err);
+
 	transform_components_to_frame(context, frame);
 
 	return RET_SUCCESS;
 }
 
-int frame_to_ycc(struct frame *frame)
+void frame_to_ycc_rows(struct frame *frame, size_t begin, size_t end)
 {
 	assert(frame != NULL);
 
-	int shift = 1 << (frame->precision - 1);
+	const struct kernels *kernels = frame->kernels;
 
 	switch (frame->components) {
 		case 3:
-			for (size_t y = 0; y < frame->Y; ++y) {
-				for (size_t x = 0; x < frame->X; ++x) {
-					float R = frame->data[y * frame->size_x * 3 + x * 3 + 0];
-					float G = frame->data[y * frame->size_x * 3 + x * 3 + 1];
-					float B = frame->data[y * frame->size_x * 3 + x * 3 + 2];
-
-					float Y  = 0.299 * R + 0.587 * G + 0.114 * B;
-					float Cb = - 0.1687 * R - 0.3313 * G + 0.5 * B + shift;
-					float Cr = 0.5 * R - 0.4187 * G - 0.0813 * B + shift;
-
-					frame->data[y * frame->size_x * 3 + x * 3 + 0] = Y;
-					frame->data[y * frame->size_x * 3 + x * 3 + 1] = Cb;
-					frame->data[y * frame->size_x * 3 + x * 3 + 2] = Cr;
-				}
+			for (size_t y = begin; y < end; ++y) {
+				kernels->rgb_to_ycc_line(&frame->data[y * frame->size_x * 3], frame->X, frame->precision);
 			}
 			break;
 		case 1:
@@ -181,56 +233,23 @@ int frame_to_ycc(struct frame *frame)
 		default:
 			abort();
 	}
-
-	return RET_SUCCESS;
 }
 
-int frame_to_rgb(struct frame *frame)
+void frame_to_rgb_rows(struct frame *frame, size_t begin, size_t end)
 {
 	assert(frame != NULL);
 
-	int shift = 1 << (frame->precision - 1);
-	int denom = 1 << frame->precision;
+	const struct kernels *kernels = frame->kernels;
 
 	switch (frame->components) {
 		case 4:
-			for (size_t y = 0; y < frame->Y; ++y) {
-				for (size_t x = 0; x < frame->X; ++x) {
-					float Y_ = frame->data[y * frame->size_x * 4 + x * 4 + 0];
-					float Cb = frame->data[y * frame->size_x * 4 + x * 4 + 1];
-					float Cr = frame->data[y * frame->size_x * 4 + x * 4 + 2];
-					float K  = frame->data[y * frame->size_x * 4 + x * 4 + 3];
-
-					float C = Y_ + 1.402 * (Cr - shift);
-					float M = Y_ - 0.34414 * (Cb - shift) - 0.71414 * (Cr - shift);
-					float Y = Y_ + 1.772 * (Cb - shift);
-
-					float R = K - (C * K) / denom;
-					float G = K - (M * K) / denom;
-					float B = K - (Y * K) / denom;
-
-					frame->data[y * frame->size_x * 4 + x * 4 + 0] = R;
-					frame->data[y * frame->size_x * 4 + x * 4 + 1] = G;
-					frame->data[y * frame->size_x * 4 + x * 4 + 2] = B;
-					frame->data[y * frame->size_x * 4 + x * 4 + 3] = 0xff;
-				}
+			for (size_t y = begin; y < end; ++y) {
+				kernels->ycck_to_rgb_line(&frame->data[y * frame->size_x * 4], frame->X, frame->precision);
 			}
 			break;
 		case 3:
-			for (size_t y = 0; y < frame->Y; ++y) {
-				for (size_t x = 0; x < frame->X; ++x) {
-					float Y  = frame->data[y * frame->size_x * 3 + x * 3 + 0];
-					float Cb = frame->data[y * frame->size_x * 3 + x * 3 + 1];
-					float Cr = frame->data[y * frame->size_x * 3 + x * 3 + 2];
-
-					float R = Y + 1.402 * (Cr - shift);
-					float G = Y - 0.34414 * (Cb - shift) - 0.71414 * (Cr - shift);
-					float B = Y + 1.772 * (Cb - shift);
-
-					frame->data[y * frame->size_x * 3 + x * 3 + 0] = R;
-					frame->data[y * frame->size_x * 3 + x * 3 + 1] = G;
-					frame->data[y * frame->size_x * 3 + x * 3 + 2] = B;
-				}
+			for (size_t y = begin; y < end; ++y) {
+				kernels->ycc_to_rgb_line(&frame->data[y * frame->size_x * 3], frame->X, frame->precision);
 			}
 			break;
 		case 1:
@@ -239,6 +258,32 @@ int frame_to_rgb(struct frame *frame)
 		default:
 			abort();
 	}
+}
+
+static void frame_to_ycc_band(void *arg, size_t begin, size_t end)
+{
+	frame_to_ycc_rows(arg, begin, end);
+}
+
+static void frame_to_rgb_band(void *arg, size_t begin, size_t end)
+{
+	frame_to_rgb_rows(arg, begin, end);
+}
+
+int frame_to_ycc(struct frame *frame)
+{
+	assert(frame != NULL);
+
+	pool_for(frame->pool, frame->Y, 16, frame_to_ycc_band, frame);
+
+	return RET_SUCCESS;
+}
+
+int frame_to_rgb(struct frame *frame)
+{
+	assert(frame != NULL);
+
+	pool_for(frame->pool, frame->Y, 16, frame_to_rgb_band, frame);
 
 	return RET_SUCCESS;
 }
@@ -274,7 +319,7 @@ uint8_t convert_maxval_to_precision(int maxval)
 	return floor_log2((unsigned)maxval) + 1;
 }
 
-int read_frame_body(struct frame *frame, FILE *stream)
+int read_frame_body(struct frame *frame, struct source *source)
 {
 	assert(frame != NULL);
 
@@ -285,53 +330,25 @@ int read_frame_body(struct frame *frame, FILE *stream)
 	size_t width = (size_t)frame->X;
 	size_t height = (size_t)frame->Y;
 	size_t line_size = sample_size * components * width;
+	const struct kernels *kernels = frame->kernels;
 
-	void *line = malloc(line_size);
-
-	if (line == NULL) {
-		return RET_FAILURE_MEMORY_ALLOCATION;
+	if (sample_size == 0) {
+		return RET_FAILURE_LOGIC_ERROR;
 	}
 
 	for (size_t y = 0; y < height; ++y) {
-		if (fread(line, 1, line_size, stream) < line_size) {
-			free(line);
+		if (source_fill(source, line_size)) {
 			return RET_FAILURE_FILE_IO;
 		}
-		switch (sample_size) {
-			case sizeof(uint8_t): {
-				uint8_t *line_ = line;
-				for (size_t x = 0; x < width; ++x) {
-					for (int c = 0; c < components; ++c) {
-						frame->data[y * frame->size_x * Nf + x * Nf + c] = (float)*line_++;
-					}
-				}
-				/* padding */
-				for (size_t x = width; x < frame->size_x; ++x) {
-					for (int c = 0; c < components; ++c) {
-						frame->data[y * frame->size_x * Nf + x * Nf + c] =
-							frame->data[y * frame->size_x * Nf + (width - 1) * Nf + c];
-					}
-				}
-				break;
-			}
-			case sizeof(uint16_t): {
-				uint16_t *line_ = line;
-				for (size_t x = 0; x < width; ++x) {
-					for (int c = 0; c < components; ++c) {
-						frame->data[y * frame->size_x * Nf + x * Nf + c] = (float)ntohs(*line_++);
-					}
-				}
-				/* padding */
-				for (size_t x = width; x < frame->size_x; ++x) {
-					for (int c = 0; c < components; ++c) {
-						frame->data[y * frame->size_x * Nf + x * Nf + c] =
-							frame->data[y * frame->size_x * Nf + (width - 1) * Nf + c];
-					}
-				}
-				break;
+		/* unpacked in place */
+		kernels->unpack_line(source->data + source->pos, &frame->data[y * frame->size_x * Nf], width, components, frame->precision);
+		source->pos += line_size;
+		/* padding */
+		for (size_t x = width; x < frame->size_x; ++x) {
+			for (int c = 0; c < components; ++c) {
+				frame->data[y * frame->size_x * Nf + x * Nf + c] =
+					frame->data[y * frame->size_x * Nf + (width - 1) * Nf + c];
 			}
-			default:
-				return RET_FAILURE_LOGIC_ERROR;
 		}
 	}
 	/* padding */
@@ -344,8 +361,6 @@ int read_frame_body(struct frame *frame, FILE *stream)
 		}
 	}
 
-	free(line);
-
 	return RET_SUCCESS;
 }
 
@@ -359,48 +374,26 @@ int write_frame_body(struct frame *frame, int components, FILE *stream)
 	size_t width = (size_t)frame->X;
 	size_t height = (size_t)frame->Y;
 	size_t line_size = sample_size * components * width;
+	const struct kernels *kernels = frame->kernels;
 
-	void *line = malloc(line_size);
+	if (sample_size == 0) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	void *line = arena_alloc(frame->arena, MEM_IO, line_size);
 
 	if (line == NULL) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
 	for (size_t y = 0; y < height; ++y) {
-		switch (sample_size) {
-			case sizeof(uint8_t): {
-				uint8_t *line_ = line;
-				for (size_t x = 0; x < width; ++x) {
-					for (int c = 0; c < components; ++c) {
-						float sample = roundf(frame->data[y * frame->size_x * Nf + x * Nf + c]);
-						*line_++ = (uint8_t)clamp(0, (int)sample, maxval);
-					}
-				}
-				break;
-			}
-			case sizeof(uint16_t): {
-				uint16_t *line_ = line;
-				for (size_t x = 0; x < width; ++x) {
-					for (int c = 0; c < components; ++c) {
-						float sample = roundf(frame->data[y * frame->size_x * Nf + x * Nf + c]);
-						*line_++ = htons((uint16_t)clamp(0, (int)sample, maxval));
-					}
-				}
-				break;
-			}
-			default:
-				free(line);
-				return RET_FAILURE_LOGIC_ERROR;
-		}
+		kernels->pack_line(&frame->data[y * frame->size_x * Nf], line, width, Nf, components, frame->precision);
 		/* write line */
 		if (fwrite(line, 1, line_size, stream) < line_size) {
-			free(line);
 			return RET_FAILURE_FILE_IO;
 		}
 	}
 
-	free(line);
-
 	return RET_SUCCESS;
 }
 
@@ -428,34 +421,68 @@ int write_frame_header(struct frame *frame, int components, FILE *stream)
 	return RET_SUCCESS;
 }
 
-int stream_skip_comment(FILE *stream)
+int source_skip_comment(struct source *source)
 {
-	int c;
+	/* look ahead for a comment */
+	while (source_peek(source) == '#') {
+		int c;
+
+		do {
+			c = source_getc(source);
+		} while (c != '\n' && c != -1);
 
-	/* look ahead for a comment, ungetc */
-	while ((c = getc(stream)) == '#') {
-		char com[4096];
-		if (NULL == fgets(com, 4096, stream))
+		if (c == -1) {
 			return RET_FAILURE_FILE_IO;
+		}
 	}
 
-	if (EOF == ungetc(c, stream))
+	return RET_SUCCESS;
+}
+
+void source_skip_space(struct source *source)
+{
+	while (source_peek(source) != -1 && isspace(source_peek(source))) {
+		source->pos++;
+	}
+}
+
+/* the equivalent of fscanf(" %u"), fails on values above max */
+int source_scan_uint(struct source *source, unsigned long max, unsigned long *value)
+{
+	unsigned long v = 0;
+
+	source_skip_space(source);
+
+	if (source_peek(source) == -1 || !isdigit(source_peek(source))) {
 		return RET_FAILURE_FILE_IO;
+	}
+
+	while (source_peek(source) != -1 && isdigit(source_peek(source))) {
+		v = v * 10 + (unsigned long)(source_getc(source) - '0');
+
+		if (v > max) {
+			return RET_FAILURE_FILE_UNSUPPORTED;
+		}
+	}
+
+	*value = v;
 
 	return RET_SUCCESS;
 }
 
-int read_frame_header(struct frame *frame, FILE *stream)
+int read_frame_header(struct frame *frame, struct source *source)
 {
+	int err;
 	char magic[2];
-	int maxval;
-	uint16_t height, width;
+	unsigned long maxval;
+	unsigned long height, width;
 	uint8_t precision;
 	uint8_t components;
 
-	if (fscanf(stream, "%c%c ", magic, magic + 1) != 2) {
-		return RET_FAILURE_FILE_IO;
-	}
+	err = source_read(source, magic, 2);
+	RETURN_IF(err);
+
+	source_skip_space(source);
 
 	if (magic[0] != 'P') {
 		return RET_FAILURE_FILE_UNSUPPORTED;
@@ -472,41 +499,42 @@ int read_frame_header(struct frame *frame, FILE *stream)
 			return RET_FAILURE_FILE_UNSUPPORTED;
 	}
 
-	if (stream_skip_comment(stream)) {
-		return RET_FAILURE_FILE_IO;
-	}
+	err = source_skip_comment(source);
+	RETURN_IF(err);
 
-	if (fscanf(stream, " %" SCNu16 " ", &width) != 1) {
-		return RET_FAILURE_FILE_IO;
-	}
+	err = source_scan_uint(source, UINT16_MAX, &width);
+	RETURN_IF(err);
 
-	if (stream_skip_comment(stream)) {
-		return RET_FAILURE_FILE_IO;
-	}
+	source_skip_space(source);
 
-	if (fscanf(stream, " %" SCNu16 " ", &height) != 1) {
-		return RET_FAILURE_FILE_IO;
-	}
+	err = source_skip_comment(source);
+	RETURN_IF(err);
 
-	if (stream_skip_comment(stream)) {
-		return RET_FAILURE_FILE_IO;
-	}
+	err = source_scan_uint(source, UINT16_MAX, &height);
+	RETURN_IF(err);
 
-	if (fscanf(stream, " %i", &maxval) != 1) {
-		return RET_FAILURE_FILE_IO;
+	source_skip_space(source);
+
+	err = source_skip_comment(source);
+	RETURN_IF(err);
+
+	err = source_scan_uint(source, UINT16_MAX, &maxval);
+	RETURN_IF(err);
+
+	if (maxval == 0) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
 	}
 
-	precision = convert_maxval_to_precision(maxval);
+	precision = convert_maxval_to_precision((int)maxval);
 
 	if (precision > 16) {
 		return RET_FAILURE_FILE_UNSUPPORTED;
 	}
 
-	if (stream_skip_comment(stream)) {
-		return RET_FAILURE_FILE_IO;
-	}
+	err = source_skip_comment(source);
+	RETURN_IF(err);
 
-	if (!isspace(fgetc(stream))) {
+	if (source_peek(source) == -1 || !isspace(source_getc(source))) {
 		return RET_FAILURE_FILE_UNSUPPORTED;
 	}
 
@@ -514,35 +542,53 @@ int read_frame_header(struct frame *frame, FILE *stream)
 	assert(frame != NULL);
 
 	frame->components = components;
-	frame->Y = height;
-	frame->X = width;
+	frame->Y = (uint16_t)height;
+	frame->X = (uint16_t)width;
 	frame->precision = precision;
 
 	return RET_SUCCESS;
 }
 
-int write_frame_components(struct frame *frame, int components, const char *path)
+int write_frame_stream(struct frame *frame, FILE *stream)
 {
-	int err;
+	assert(frame != NULL);
 
-	FILE *stream = fopen(path, "w");
+	int err;
+	int components;
 
-	if (stream == NULL) {
-		return RET_FAILURE_FILE_OPEN;
+	switch (frame->components) {
+		case 4:
+		case 3:
+			components = 3;
+			break;
+		case 1:
+			components = 1;
+			break;
+		default:
+			abort();
 	}
 
 	err = write_frame_header(frame, components, stream);
-
-	if (err) {
-		goto end;
-	}
+	RETURN_IF(err);
 
 	err = write_frame_body(frame, components, stream);
+	RETURN_IF(err);
 
-end:
-	fclose(stream);
+	return RET_SUCCESS;
+}
 
-	return err;
+size_t frame_pnm_size(const struct frame *frame)
+{
+	assert(frame != NULL);
+
+	int components = frame->components == 1 ? 1 : 3;
+	int maxval = (1 << frame->precision) - 1;
+	size_t sample_size = convert_maxval_to_sample_size(maxval);
+
+	/* see write_frame_header() */
+	int header = snprintf(NULL, 0, "P6\n%" PRIu16 " %" PRIu16 "\n%i\n", frame->X, frame->Y, maxval);
+
+	return (size_t)header + sample_size * components * frame->X * frame->Y;
 }
 
 int write_frame(struct frame *frame, const char *path)
@@ -551,16 +597,20 @@ int write_frame(struct frame *frame, const char *path)
 
 	int err;
 
-	switch (frame->components) {
-		case 4:
-		case 3:
-			err = write_frame_components(frame, 3, path != NULL ? path : "output.ppm");
-			break;
-		case 1:
-			err = write_frame_components(frame, 1, path != NULL ? path : "output.pgm");
-			break;
-		default:
-			abort();
+	if (path == NULL) {
+		path = frame->components == 1 ? "output.pgm" : "output.ppm";
+	}
+
+	FILE *stream = open_output(path);
+
+	if (stream == NULL) {
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	err = write_frame_stream(frame, stream);
+
+	if (fclose(stream) != 0 && !err) {
+		err = RET_FAILURE_FILE_IO;
 	}
 
 	return err;
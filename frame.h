@@ -2,8 +2,10 @@
 #define JPEG_FRAME_H
 
 #include <stddef.h>
+#include <stdio.h>
 #include <stdint.h>
 #include "common.h"
+#include "source.h"
 
 struct frame {
 	uint8_t components;
@@ -11,25 +13,52 @@ struct frame {
 	size_t size_x, size_y;
 	uint8_t precision;
 
+	/* kernels specialized for the precision */
+	const struct kernels *kernels;
+
+	/* thread pool, NULL = single-threaded */
+	struct pool *pool;
+
+	/* holds the data */
+	struct arena *arena;
+
 	float *data;
 };
 
 int frame_create(struct context *context, struct frame *frame);
 
+/* the frame of the context geometry, without copying the components */
+int frame_create_blank(struct context *context, struct frame *frame);
+
 void frame_destroy(struct frame *frame);
 
 int frame_to_rgb(struct frame *frame);
 
+/* PNM file, the default path is used for NULL */
 int write_frame(struct frame *frame, const char *path);
 
-int read_frame_header(struct frame *frame, FILE *stream);
+int write_frame_stream(struct frame *frame, FILE *stream);
+
+/* number of bytes written by write_frame_stream() */
+size_t frame_pnm_size(const struct frame *frame);
+
+int read_frame_header(struct frame *frame, struct source *source);
 
 int frame_create_empty(struct context *context, struct frame *frame);
 
-int read_frame_body(struct frame *frame, FILE *stream);
+int read_frame_body(struct frame *frame, struct source *source);
 
 void transform_frame_to_components(struct context *context, struct frame *frame);
 
 int frame_to_ycc(struct frame *frame);
 
+/* process the rows [begin, end) */
+void transform_component_to_frame_rows(struct component *component, int compno, struct frame *frame, size_t begin, size_t end);
+
+void transform_frame_to_component_rows(struct component *component, int compno, struct frame *frame, size_t begin, size_t end);
+
+void frame_to_rgb_rows(struct frame *frame, size_t begin, size_t end);
+
+void frame_to_ycc_rows(struct frame *frame, size_t begin, size_t end);
+
 #endif
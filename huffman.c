@@ -1,4 +1,5 @@
 #include <stddef.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -133,7 +134,7 @@ int order_codes(struct htable *htable, struct hcode *hcode)
 		uint8_t I = HUFFVAL(K);
 		EHUFCO(I) = HUFFCODE(K);
 		EHUFSI(I) = HUFFSIZE(K);
-// 		printf("[DEBUG] value=%i cat=%i size=%zu code=%" PRIu16 "\n", I, I & 15, EHUFSI(I), EHUFCO(I));
+		msg_trace("value = %" PRIu8 ", cat = %i, size = %" PRIu8 ", code = %" PRIu16 "\n", I, I & 15, EHUFSI(I), EHUFCO(I));
 		K++;
 	} while (K < LASTK);
 
@@ -154,15 +155,19 @@ int conv_htable_to_hcode(struct htable *htable, struct hcode *hcode)
 	assert(htable != NULL);
 	assert(hcode != NULL);
 
-	uint8_t *v = hcode->huff_val;
+	size_t values = 0;
 
 	for (int i = 0; i < 16; ++i) {
-		uint8_t L = htable->L[i];
+		values += htable->L[i];
+	}
 
-		for (int l = 0; l < L; ++l) {
-			*v = htable->V[i][l];
-			v++;
-		}
+	/* one code point is reserved */
+	if (values > 255) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	for (size_t k = 0; k < values; ++k) {
+		hcode->huff_val[k] = htable->V[k];
 	}
 
 	err = generate_size_table(htable, hcode);
@@ -190,7 +195,7 @@ int conv_htable_to_hcode(struct htable *htable, struct hcode *hcode)
  * // value ... category code
  * // read extra bits
  */
-int query_code(struct vlc *vlc, struct hcode *hcode, uint8_t *value)
+int query_code(struct vlc *vlc, const struct hcode *hcode, uint8_t *value)
 {
 	assert(vlc != NULL);
 	assert(hcode != NULL);
@@ -225,7 +230,7 @@ int query_code(struct vlc *vlc, struct hcode *hcode, uint8_t *value)
 }
 
 /* transform value to (code, size), inverse of query_code() */
-int value_to_vlc(struct vlc *vlc, struct hcode *hcode, uint8_t value)
+int value_to_vlc(struct vlc *vlc, const struct hcode *hcode, uint8_t value)
 {
 	assert(vlc != NULL);
 	assert(hcode != NULL);
@@ -252,7 +257,7 @@ int value_to_vlc(struct vlc *vlc, struct hcode *hcode, uint8_t value)
 	return -1; /* not found */
 }
 
-int read_code(struct bits *bits, struct hcode *hcode, uint8_t *value)
+int read_code(struct bits *bits, const struct hcode *hcode, uint8_t *value)
 {
 	int err;
 	struct vlc vlc;
@@ -271,7 +276,7 @@ int read_code(struct bits *bits, struct hcode *hcode, uint8_t *value)
 }
 
 /* inverse of read_code() */
-int write_code(struct bits *bits, struct hcode *hcode, uint8_t value)
+int write_code(struct bits *bits, const struct hcode *hcode, uint8_t value)
 {
 	int err;
 	struct vlc vlc;
@@ -410,6 +415,114 @@ void code_size(struct huffenc *huffenc)
 #undef OTHERS
 }
 
+/* sort by increasing frequency, the largest value first on ties (as K.2 does) */
+static int compare_freq(const void *a, const void *b, void *arg)
+{
+	const size_t *freq = arg;
+	int v1 = *(const int *)a;
+	int v2 = *(const int *)b;
+
+	if (freq[v1] != freq[v2]) {
+		return freq[v1] < freq[v2] ? -1 : +1;
+	}
+
+	return v2 - v1;
+}
+
+/*
+ * Package-merge algorithm, gives the optimal code lengths limited to 16 bits.
+ *
+ * The list at the depth 16 contains the symbols sorted by frequency, the
+ * list at each lower depth merges the symbols with the pairs (packages) of
+ * the list one level deeper. The first 2n-2 items at the depth 1 are
+ * selected, and the length of each symbol is the number of the selected
+ * lists in which it appears. Since both the symbols and the packages are
+ * sorted, a prefix of the list always contains a prefix of the symbols, so
+ * only the number of symbols in each prefix needs to be remembered.
+ *
+ * The reserved value 256 (with frequency 1) sorts first and gets one of the
+ * longest codes, which is then removed by adjust_bits().
+ */
+void code_size_limited(struct huffenc *huffenc)
+{
+	assert(huffenc != NULL);
+
+#define FREQ(V)     (huffenc->freq[(V)])
+#define CODESIZE(V) (huffenc->codesize[(V)])
+
+	int sym[257];
+	int n = 0;
+
+	for (int v = 0; v < 257; ++v) {
+		CODESIZE(v) = 0;
+
+		if (FREQ(v) > 0) {
+			sym[n++] = v;
+		}
+	}
+
+	assert(n > 0);
+
+	if (n == 1) {
+		CODESIZE(sym[0]) = 1;
+		return;
+	}
+
+	qsort_r(sym, (size_t)n, sizeof(int), compare_freq, huffenc->freq);
+
+	/* weights of the list one level deeper */
+	size_t weight[2 * 257];
+	size_t size = 0;
+	/* leaves[d][k] = number of symbols among the first k items at the depth d */
+	uint16_t leaves[17][2 * 257 + 1];
+
+	for (int d = 16; d >= 1; --d) {
+		size_t merged[2 * 257];
+		size_t packages = size / 2;
+		size_t m = 0;
+		int i = 0;
+		size_t p = 0;
+
+		leaves[d][0] = 0;
+
+		while (i < n || p < packages) {
+			size_t package = p < packages ? weight[2 * p] + weight[2 * p + 1] : 0;
+
+			if (i < n && (p == packages || FREQ(sym[i]) <= package)) {
+				merged[m] = FREQ(sym[i++]);
+				leaves[d][m + 1] = leaves[d][m] + 1;
+			} else {
+				merged[m] = package;
+				leaves[d][m + 1] = leaves[d][m];
+				p++;
+			}
+			m++;
+		}
+
+		for (size_t k = 0; k < m; ++k) {
+			weight[k] = merged[k];
+		}
+		size = m;
+	}
+
+	/* select the items */
+	size_t count = 2 * (size_t)n - 2;
+
+	for (int d = 1; d <= 16 && count > 0; ++d) {
+		size_t l = leaves[d][count];
+
+		for (size_t k = 0; k < l; ++k) {
+			CODESIZE(sym[k])++;
+		}
+
+		/* the packages expand into twice as many items one level deeper */
+		count = 2 * (count - l);
+	}
+
+#undef FREQ
+#undef CODESIZE
+}
+
 void adjust_bits(struct huffenc *huffenc)
 {
 	assert(huffenc != NULL);
@@ -490,7 +603,7 @@ void sort_input(struct huffenc *huffenc)
 			assert(j < 257);
 
 			if (CODESIZE(j) == (size_t)i) {
-				assert(k < 16 * 255);
+				assert(k < 257);
 
 				HUFFVAL(k) = j;
 				k++;
@@ -505,12 +618,21 @@ void sort_input(struct huffenc *huffenc)
 #undef HUFFVAL
 }
 
-int adapt_huffman_table(struct htable *htable, struct huffenc *huffenc)
+int adapt_huffman_table(struct htable *htable, struct huffenc *huffenc, int method)
 {
 	assert(htable != NULL);
 	assert(huffenc != NULL);
 
-	code_size(huffenc);
+	switch (method) {
+		case HUFFMAN_ANNEX_K:
+			code_size(huffenc);
+			break;
+		case HUFFMAN_PACKAGE_MERGE:
+			code_size_limited(huffenc);
+			break;
+		default:
+			return RET_FAILURE_LOGIC_ERROR;
+	}
 
 	count_bits(huffenc);
 
@@ -522,15 +644,14 @@ int adapt_huffman_table(struct htable *htable, struct huffenc *huffenc)
 	}
 
 	// fill htable.V[]
-	uint8_t *v = huffenc->huff_val;
+	size_t values = 0;
 
 	for (int i = 0; i < 16; ++i) {
-		uint8_t L = htable->L[i];
+		values += htable->L[i];
+	}
 
-		for (int l = 0; l < L; ++l) {
-			htable->V[i][l] = *v;
-			v++;
-		}
+	for (size_t k = 0; k < values; ++k) {
+		htable->V[k] = huffenc->huff_val[k];
 	}
 
 	return RET_SUCCESS;
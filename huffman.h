@@ -30,19 +30,27 @@ int conv_htable_to_hcode(struct htable *htable, struct hcode *hcode);
 /*
  * query if the code is present in htable/hcode, and return its value
  */
-int query_code(struct vlc *vlc, struct hcode *hcode, uint8_t *value);
+int query_code(struct vlc *vlc, const struct hcode *hcode, uint8_t *value);
 
-int read_code(struct bits *bits, struct hcode *hcode, uint8_t *value);
+int read_code(struct bits *bits, const struct hcode *hcode, uint8_t *value);
 
-int write_code(struct bits *bits, struct hcode *hcode, uint8_t value);
+int write_code(struct bits *bits, const struct hcode *hcode, uint8_t value);
 
 int read_extra_bits(struct bits *bits, uint8_t count, uint16_t *value);
 
 int write_extra_bits(struct bits *bits, uint8_t count, uint16_t value);
 
+/* construction of the adapted code lengths, matches the -o values of the encoder */
+enum {
+	/* K.2 procedure, lengths limited by the adjust_bits() heuristic */
+	HUFFMAN_ANNEX_K = 1,
+	/* package-merge, optimal lengths limited to 16 bits */
+	HUFFMAN_PACKAGE_MERGE = 2
+};
+
 /*
  * adaptive Huffman
  */
-int adapt_huffman_table(struct htable *htable, struct huffenc *huffenc);
+int adapt_huffman_table(struct htable *htable, struct huffenc *huffenc, int method);
 
 #endif
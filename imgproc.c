@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include "imgproc.h"
 #include "coeffs.h"
+#include "pool.h"
 
 void dequantize_block(struct int_block *int_block, struct flt_block *flt_block, struct qtable *qtable)
 {
@@ -29,170 +30,253 @@ void quantize_block(struct int_block *int_block, struct flt_block *flt_block, st
 	}
 }
 
-int dequantize(struct context *context)
+/* component processed by a pool job */
+struct band {
+	struct context *context;
+	struct component *component;
+};
+
+void dequantize_blocks(struct context *context, struct component *component, size_t begin, size_t end)
 {
 	assert(context != NULL);
+	assert(component != NULL);
 
-	for (int i = 0; i < 256; ++i) {
-		if (context->component[i].int_buffer != NULL) {
-			printf("Dequantizing component %i...\n", i);
+	uint8_t Tq = component->Tq;
+	struct qtable *qtable = &context->qtable[Tq];
 
-			size_t blocks = context->component[i].b_x * context->component[i].b_y;
+	// for each block, for each coefficient, c[] *= Q[]
+	for (size_t b = begin; b < end; ++b) {
+		struct int_block *int_block = &component->int_buffer[b];
+		struct flt_block *flt_block = &component->flt_buffer[b];
 
-			uint8_t Tq = context->component[i].Tq;
-			struct qtable *qtable = &context->qtable[Tq];
+		dequantize_block(int_block, flt_block, qtable);
+	}
+}
 
-			// for each block, for each coefficient, c[] *= Q[]
-			for (size_t b = 0; b < blocks; ++b) {
-				struct int_block *int_block = &context->component[i].int_buffer[b];
-				struct flt_block *flt_block = &context->component[i].flt_buffer[b];
+void quantize_blocks(struct context *context, struct component *component, size_t begin, size_t end)
+{
+	assert(context != NULL);
+	assert(component != NULL);
 
-				dequantize_block(int_block, flt_block, qtable);
-			}
-		}
+	uint8_t Tq = component->Tq;
+	struct qtable *qtable = &context->qtable[Tq];
+
+	// for each block, for each coefficient, c[] /= Q[]
+	for (size_t b = begin; b < end; ++b) {
+		struct int_block *int_block = &component->int_buffer[b];
+		struct flt_block *flt_block = &component->flt_buffer[b];
+
+		quantize_block(int_block, flt_block, qtable);
 	}
+}
 
-	return RET_SUCCESS;
+void inverse_dct_blocks(struct context *context, struct component *component, size_t begin, size_t end)
+{
+	assert(context != NULL);
+	assert(component != NULL);
+
+	/* precision */
+	uint8_t P = context->P;
+	const struct kernels *kernels = context->kernels;
+
+	for (size_t b = begin; b < end; ++b) {
+		struct flt_block *flt_block = &component->flt_buffer[b];
+
+		// IDCT + level shift
+		kernels->inverse_dct_block(flt_block, P);
+	}
 }
 
-int quantize(struct context *context)
+void forward_dct_blocks(struct context *context, struct component *component, size_t begin, size_t end)
 {
 	assert(context != NULL);
+	assert(component != NULL);
 
-	for (int i = 0; i < 256; ++i) {
-		if (context->component[i].int_buffer != NULL) {
-			printf("Quantizing component %i...\n", i);
+	/* precision */
+	uint8_t P = context->P;
+	const struct kernels *kernels = context->kernels;
 
-			size_t blocks = context->component[i].b_x * context->component[i].b_y;
+	for (size_t b = begin; b < end; ++b) {
+		struct flt_block *flt_block = &component->flt_buffer[b];
+
+		// level shift + FDCT
+		kernels->forward_dct_block(flt_block, P);
+	}
+}
+
+void conv_blocks_to_frame_rows(struct context *context, struct component *component, size_t begin, size_t end)
+{
+	assert(context != NULL);
+	assert(component != NULL);
 
-			uint8_t Tq = context->component[i].Tq;
-			struct qtable *qtable = &context->qtable[Tq];
+	float *buffer = component->frame_buffer;
 
-			// for each block, for each coefficient, c[] *= Q[]
-			for (size_t b = 0; b < blocks; ++b) {
-				struct int_block *int_block = &context->component[i].int_buffer[b];
-				struct flt_block *flt_block = &context->component[i].flt_buffer[b];
+	size_t b_x = component->b_x;
 
-				quantize_block(int_block, flt_block, qtable);
+	for (size_t y = begin; y < end; ++y) {
+		for (size_t x = 0; x < b_x; ++x) {
+			/* copy from... */
+			struct flt_block *flt_block = &component->flt_buffer[block_index(context, component, x, y)];
+
+			for (int v = 0; v < 8; ++v) {
+				for (int u = 0; u < 8; ++u) {
+					buffer[y * b_x * 8 * 8 + v * b_x * 8 + x * 8 + u] = flt_block->c[v * 8 + u];
+				}
 			}
 		}
 	}
-
-	return RET_SUCCESS;
 }
 
-static float C(int u)
+void conv_frame_to_blocks_rows(struct context *context, struct component *component, size_t begin, size_t end)
 {
-	if (u == 0) {
-		return 1.f / sqrtf(2.f);
-	}
+	assert(context != NULL);
+	assert(component != NULL);
 
-	return 1.f;
-}
+	float *buffer = component->frame_buffer;
 
-float lut[8][8];
+	size_t b_x = component->b_x;
 
-void init_lut()
-{
-	for (int x = 0; x < 8; ++x) {
-		for (int u = 0; u < 8; ++u) {
-			lut[x][u] = 0.5f * C(u) * cosf((2 * x + 1) * u * M_PI / 16);
+	for (size_t y = begin; y < end; ++y) {
+		for (size_t x = 0; x < b_x; ++x) {
+			/* copy to... */
+			struct flt_block *flt_block = &component->flt_buffer[block_index(context, component, x, y)];
+
+			for (int v = 0; v < 8; ++v) {
+				for (int u = 0; u < 8; ++u) {
+					flt_block->c[v * 8 + u] = buffer[y * b_x * 8 * 8 + v * b_x * 8 + x * 8 + u];
+				}
+			}
 		}
 	}
 }
 
-void idct1(const float in[8], float out[8], size_t stride)
+static void dequantize_band(void *arg, size_t begin, size_t end)
 {
-	for (int x = 0; x < 8; ++x) {
-		float s = 0.f;
+	struct band *band = arg;
 
-		for (int u = 0; u < 8; ++u) {
-			s += in[u * stride] * lut[x][u];
-		}
+	dequantize_blocks(band->context, band->component, begin, end);
+}
 
-		out[x * stride] = s;
-	}
+static void quantize_band(void *arg, size_t begin, size_t end)
+{
+	struct band *band = arg;
+
+	quantize_blocks(band->context, band->component, begin, end);
 }
 
-void fdct1(const float in[8], float out[8], size_t stride)
+static void inverse_dct_band(void *arg, size_t begin, size_t end)
 {
-	for (int u = 0; u < 8; ++u) {
-		float s = 0.f;
+	struct band *band = arg;
 
-		for (int x = 0; x < 8; ++x) {
-			s += in[x * stride] * lut[x][u];
-		}
+	inverse_dct_blocks(band->context, band->component, begin, end);
+}
 
-		out[u * stride] = s;
-	}
+static void forward_dct_band(void *arg, size_t begin, size_t end)
+{
+	struct band *band = arg;
+
+	forward_dct_blocks(band->context, band->component, begin, end);
 }
 
-void idct(struct flt_block *flt_block)
+static void conv_blocks_to_frame_band(void *arg, size_t begin, size_t end)
 {
-	static int init = 0;
+	struct band *band = arg;
 
-	// init look-up table
-	if (init == 0) {
-		init_lut();
-		init = 1;
-	}
+	conv_blocks_to_frame_rows(band->context, band->component, begin, end);
+}
 
-	struct flt_block b;
+static void conv_frame_to_blocks_band(void *arg, size_t begin, size_t end)
+{
+	struct band *band = arg;
 
-	for (int y = 0; y < 8; ++y) {
-		idct1(&flt_block->c[y * 8], &b.c[y * 8], 1);
-	}
+	conv_frame_to_blocks_rows(band->context, band->component, begin, end);
+}
+
+/* the block stages are split into bands of block rows */
+int dequantize(struct context *context)
+{
+	assert(context != NULL);
 
-	for (int x = 0; x < 8; ++x) {
-		idct1(&b.c[x], &flt_block->c[x], 8);
+	for (int i = 0; i < context->Nf; ++i) {
+		if (context->component[i].int_buffer != NULL) {
+			msg_debug("Dequantizing component %i...\n", context->component[i].C);
+
+			struct band band = { context, &context->component[i] };
+			size_t blocks = context->component[i].b_x * context->component[i].b_y;
+
+			pool_for(context->pool, blocks, context->component[i].b_x, dequantize_band, &band);
+		}
 	}
+
+	return RET_SUCCESS;
 }
 
-void fdct(struct flt_block *flt_block)
+int quantize(struct context *context)
 {
-	static int init = 0;
+	assert(context != NULL);
 
-	// init look-up table
-	if (init == 0) {
-		init_lut();
-		init = 1;
-	}
+	for (int i = 0; i < context->Nf; ++i) {
+		if (context->component[i].int_buffer != NULL) {
+			msg_debug("Quantizing component %i...\n", context->component[i].C);
 
-	struct flt_block b;
+			struct band band = { context, &context->component[i] };
+			size_t blocks = context->component[i].b_x * context->component[i].b_y;
 
-	for (int y = 0; y < 8; ++y) {
-		fdct1(&flt_block->c[y * 8], &b.c[y * 8], 1);
+			pool_for(context->pool, blocks, context->component[i].b_x, quantize_band, &band);
+		}
 	}
 
-	for (int x = 0; x < 8; ++x) {
-		fdct1(&b.c[x], &flt_block->c[x], 8);
-	}
+	return RET_SUCCESS;
 }
 
+/*
+ * DCT basis, lut[x][u] ~ 0.5 * C(u) * cos((2x + 1) u pi / 16), where
+ * C(0) = 1/sqrt(2) and C(u) = 1 otherwise, and its transposition.
+ *
+ * The values are not the exact ones. They reproduce bit-for-bit the former
+ * run-time initialization, so that the output stays identical, rounding
+ * errors of cosf() included (e.g. the magnitude 9.7545e-02 appears with
+ * different trailing digits). They were printed with "%.9ef" from
+ *
+ *   0.5f * C(u) * cosf((2 * x + 1) * u * M_PI / 16)
+ *
+ * with C(0) = 1.f / sqrtf(2.f). Do not replace them with the exact values,
+ * that changes the output.
+ */
+const float lut[8][8] = {
+	{ 3.535533845e-01f, 4.903926253e-01f, 4.619397521e-01f, 4.157347977e-01f, 3.535533845e-01f, 2.777851224e-01f, 1.913417131e-01f, 9.754517674e-02f },
+	{ 3.535533845e-01f, 4.157347977e-01f, 1.913417131e-01f, -9.754516184e-02f, -3.535533845e-01f, -4.903926551e-01f, -4.619397521e-01f, -2.777852118e-01f },
+	{ 3.535533845e-01f, 2.777851224e-01f, -1.913416982e-01f, -4.903926551e-01f, -3.535534143e-01f, 9.754520655e-02f, 4.619397819e-01f, 4.157348275e-01f },
+	{ 3.535533845e-01f, 9.754517674e-02f, -4.619397521e-01f, -2.777852118e-01f, 3.535533249e-01f, 4.157348275e-01f, -1.913415045e-01f, -4.903926849e-01f },
+	{ 3.535533845e-01f, -9.754516184e-02f, -4.619397521e-01f, 2.777850330e-01f, 3.535533845e-01f, -4.157348871e-01f, -1.913419217e-01f, 4.903926253e-01f },
+	{ 3.535533845e-01f, -2.777850926e-01f, -1.913417876e-01f, 4.903926551e-01f, -3.535532951e-01f, -9.754510969e-02f, 4.619398415e-01f, -4.157347977e-01f },
+	{ 3.535533845e-01f, -4.157348275e-01f, 1.913418025e-01f, 9.754526615e-02f, -3.535532653e-01f, 4.903926551e-01f, -4.619396925e-01f, 2.777847648e-01f },
+	{ 3.535533845e-01f, -4.903926551e-01f, 4.619397819e-01f, -4.157348871e-01f, 3.535534143e-01f, -2.777850330e-01f, 1.913419515e-01f, -9.754483402e-02f },
+};
+
+const float lut_t[8][8] = {
+	{ 3.535533845e-01f, 3.535533845e-01f, 3.535533845e-01f, 3.535533845e-01f, 3.535533845e-01f, 3.535533845e-01f, 3.535533845e-01f, 3.535533845e-01f },
+	{ 4.903926253e-01f, 4.157347977e-01f, 2.777851224e-01f, 9.754517674e-02f, -9.754516184e-02f, -2.777850926e-01f, -4.157348275e-01f, -4.903926551e-01f },
+	{ 4.619397521e-01f, 1.913417131e-01f, -1.913416982e-01f, -4.619397521e-01f, -4.619397521e-01f, -1.913417876e-01f, 1.913418025e-01f, 4.619397819e-01f },
+	{ 4.157347977e-01f, -9.754516184e-02f, -4.903926551e-01f, -2.777852118e-01f, 2.777850330e-01f, 4.903926551e-01f, 9.754526615e-02f, -4.157348871e-01f },
+	{ 3.535533845e-01f, -3.535533845e-01f, -3.535534143e-01f, 3.535533249e-01f, 3.535533845e-01f, -3.535532951e-01f, -3.535532653e-01f, 3.535534143e-01f },
+	{ 2.777851224e-01f, -4.903926551e-01f, 9.754520655e-02f, 4.157348275e-01f, -4.157348871e-01f, -9.754510969e-02f, 4.903926551e-01f, -2.777850330e-01f },
+	{ 1.913417131e-01f, -4.619397521e-01f, 4.619397819e-01f, -1.913415045e-01f, -1.913419217e-01f, 4.619398415e-01f, -4.619396925e-01f, 1.913419515e-01f },
+	{ 9.754517674e-02f, -2.777852118e-01f, 4.157348275e-01f, -4.903926849e-01f, 4.903926253e-01f, -4.157347977e-01f, 2.777847648e-01f, -9.754483402e-02f },
+};
+
 int inverse_dct(struct context *context)
 {
 	assert(context != NULL);
 
-	/* precision */
-	uint8_t P = context->P;
-	int shift = 1 << (P - 1);
-
-	for (int i = 0; i < 256; ++i) {
+	for (int i = 0; i < context->Nf; ++i) {
 		if (context->component[i].int_buffer != NULL) {
-			printf("IDCT on component %i...\n", i);
+			msg_debug("IDCT on component %i...\n", context->component[i].C);
 
+			struct band band = { context, &context->component[i] };
 			size_t blocks = context->component[i].b_x * context->component[i].b_y;
 
-			for (size_t b = 0; b < blocks; ++b) {
-				struct flt_block *flt_block = &context->component[i].flt_buffer[b];
-
-				idct(flt_block);
-
-				// level shift
-				for (int j = 0; j < 64; ++j) {
-					flt_block->c[j] += shift;
-				}
-			}
+			pool_for(context->pool, blocks, context->component[i].b_x, inverse_dct_band, &band);
 		}
 	}
 
@@ -203,26 +287,14 @@ int forward_dct(struct context *context)
 {
 	assert(context != NULL);
 
-	/* precision */
-	uint8_t P = context->P;
-	int shift = 1 << (P - 1);
-
-	for (int i = 0; i < 256; ++i) {
+	for (int i = 0; i < context->Nf; ++i) {
 		if (context->component[i].int_buffer != NULL) {
-			printf("FDCT on component %i...\n", i);
+			msg_debug("FDCT on component %i...\n", context->component[i].C);
 
+			struct band band = { context, &context->component[i] };
 			size_t blocks = context->component[i].b_x * context->component[i].b_y;
 
-			for (size_t b = 0; b < blocks; ++b) {
-				struct flt_block *flt_block = &context->component[i].flt_buffer[b];
-
-				// level shift
-				for (int j = 0; j < 64; ++j) {
-					flt_block->c[j] -= shift;
-				}
-
-				fdct(flt_block);
-			}
+			pool_for(context->pool, blocks, context->component[i].b_x, forward_dct_band, &band);
 		}
 	}
 
@@ -234,27 +306,13 @@ int conv_blocks_to_frame(struct context *context)
 {
 	assert(context != NULL);
 
-	for (int i = 0; i < 256; ++i) {
+	for (int i = 0; i < context->Nf; ++i) {
 		if (context->component[i].frame_buffer != NULL) {
-			printf("converting component %i...\n", i);
-
-			float *buffer = context->component[i].frame_buffer;
-
-			size_t b_x = context->component[i].b_x;
-			size_t b_y = context->component[i].b_y;
+			msg_debug("converting component %i...\n", context->component[i].C);
 
-			for (size_t y = 0; y < b_y; ++y) {
-				for (size_t x = 0; x < b_x; ++x) {
-					/* copy from... */
-					struct flt_block *flt_block = &context->component[i].flt_buffer[y * b_x + x];
+			struct band band = { context, &context->component[i] };
 
-					for (int v = 0; v < 8; ++v) {
-						for (int u = 0; u < 8; ++u) {
-							buffer[y * b_x * 8 * 8 + v * b_x * 8 + x * 8 + u] = flt_block->c[v * 8 + u];
-						}
-					}
-				}
-			}
+			pool_for(context->pool, context->component[i].b_y, 1, conv_blocks_to_frame_band, &band);
 		}
 	}
 
@@ -265,27 +323,13 @@ int conv_frame_to_blocks(struct context *context)
 {
 	assert(context != NULL);
 
-	for (int i = 0; i < 256; ++i) {
+	for (int i = 0; i < context->Nf; ++i) {
 		if (context->component[i].frame_buffer != NULL) {
-			printf("converting component %i...\n", i);
-
-			float *buffer = context->component[i].frame_buffer;
+			msg_debug("converting component %i...\n", context->component[i].C);
 
-			size_t b_x = context->component[i].b_x;
-			size_t b_y = context->component[i].b_y;
+			struct band band = { context, &context->component[i] };
 
-			for (size_t y = 0; y < b_y; ++y) {
-				for (size_t x = 0; x < b_x; ++x) {
-					/* copy to... */
-					struct flt_block *flt_block = &context->component[i].flt_buffer[y * b_x + x];
-
-					for (int v = 0; v < 8; ++v) {
-						for (int u = 0; u < 8; ++u) {
-							flt_block->c[v * 8 + u] = buffer[y * b_x * 8 * 8 + v * b_x * 8 + x * 8 + u];
-						}
-					}
-				}
-			}
+			pool_for(context->pool, context->component[i].b_y, 1, conv_frame_to_blocks_band, &band);
 		}
 	}
 
@@ -11,6 +11,26 @@ int quantize(struct context *context);
 
 void dequantize_block(struct int_block *int_block, struct flt_block *flt_block, struct qtable *qtable);
 
+void quantize_block(struct int_block *int_block, struct flt_block *flt_block, struct qtable *qtable);
+
+/* process the blocks [begin, end) of the component */
+void dequantize_blocks(struct context *context, struct component *component, size_t begin, size_t end);
+
+void quantize_blocks(struct context *context, struct component *component, size_t begin, size_t end);
+
+void inverse_dct_blocks(struct context *context, struct component *component, size_t begin, size_t end);
+
+void forward_dct_blocks(struct context *context, struct component *component, size_t begin, size_t end);
+
+/* process the block rows [begin, end) of the component */
+void conv_blocks_to_frame_rows(struct context *context, struct component *component, size_t begin, size_t end);
+
+void conv_frame_to_blocks_rows(struct context *context, struct component *component, size_t begin, size_t end);
+
+/* DCT basis, lut[x][u], and its transposition */
+extern const float lut[8][8];
+extern const float lut_t[8][8];
+
 int inverse_dct(struct context *context);
 
 int forward_dct(struct context *context);
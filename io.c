@@ -1,5 +1,7 @@
 #include <arpa/inet.h>
 #include <assert.h>
+#include <string.h>
+#include <unistd.h>
 #include "io.h"
 #include "common.h"
 
@@ -9,6 +11,18 @@ int init_bits(struct bits *bits, FILE *stream)
 
 	bits->count = 0;
 	bits->stream = stream;
+	bits->source = NULL;
+
+	return RET_SUCCESS;
+}
+
+int init_bits_source(struct bits *bits, struct source *source)
+{
+	assert(bits != NULL);
+
+	bits->count = 0;
+	bits->stream = NULL;
+	bits->source = source;
 
 	return RET_SUCCESS;
 }
@@ -23,7 +37,7 @@ int next_bit(struct bits *bits, uint8_t *bit)
 
 	if (bits->count == 0) {
 		/* refill bits->byte */
-		err = read_ecs_byte(bits->stream, &bits->byte);
+		err = read_ecs_byte(bits->source, &bits->byte);
 		RETURN_IF(err); /* incl. RET_FAILURE_NO_MORE_DATA */
 
 		bits->count = 8;
@@ -86,12 +100,16 @@ int flush_bits(struct bits *bits)
 	return RET_SUCCESS;
 }
 
-int read_byte(FILE *stream, uint8_t *byte)
+int read_byte(struct source *source, uint8_t *byte)
 {
-	if (fread(byte, sizeof(uint8_t), 1, stream) != 1) {
+	int c = source_getc(source);
+
+	if (c < 0) {
 		return RET_FAILURE_FILE_IO;
 	}
 
+	*byte = (uint8_t)c;
+
 	return RET_SUCCESS;
 }
 
@@ -104,15 +122,16 @@ int write_byte(FILE *stream, uint8_t byte)
 	return RET_SUCCESS;
 }
 
-int read_word(FILE *stream, uint16_t *word)
+int read_word(struct source *source, uint16_t *word)
 {
-	uint16_t w;
-
-	if (fread(&w, sizeof(uint16_t), 1, stream) != 1) {
+	if (source_fill(source, 2)) {
 		return RET_FAILURE_FILE_IO;
 	}
 
-	w = ntohs(w);
+	/* big endian */
+	uint16_t w = (uint16_t)(source->data[source->pos] << 8 | source->data[source->pos + 1]);
+
+	source->pos += 2;
 
 	assert(word != NULL);
 
@@ -132,11 +151,11 @@ int write_word(FILE *stream, uint16_t word)
 	return RET_SUCCESS;
 }
 
-int read_length(FILE *stream, uint16_t *len)
+int read_length(struct source *source, uint16_t *len)
 {
 	int err;
 
-	err = read_word(stream, len);
+	err = read_word(source, len);
 	RETURN_IF(err);
 
 	return RET_SUCCESS;
@@ -152,7 +171,7 @@ int write_length(FILE *stream, uint16_t len)
 	return RET_SUCCESS;
 }
 
-int read_nibbles(FILE *stream, uint8_t *first, uint8_t *second)
+int read_nibbles(struct source *source, uint8_t *first, uint8_t *second)
 {
 	int err;
 	uint8_t byte;
@@ -160,7 +179,7 @@ int read_nibbles(FILE *stream, uint8_t *first, uint8_t *second)
 	assert(first != NULL);
 	assert(second != NULL);
 
-	err = read_byte(stream, &byte);
+	err = read_byte(source, &byte);
 	RETURN_IF(err);
 
 	/* The first 4-bit parameter of the pair shall occupy the most significant 4 bits of the byte.  */
@@ -183,7 +202,7 @@ int write_nibbles(FILE *stream, uint8_t first, uint8_t second)
 
 /* B.1.1.2 Markers
  * All markers are assigned two-byte codes */
-int read_marker(FILE *stream, uint16_t *marker)
+int read_marker(struct source *source, uint16_t *marker)
 {
 	int err;
 	uint8_t byte;
@@ -191,15 +210,15 @@ int read_marker(FILE *stream, uint16_t *marker)
 	/* Any marker may optionally be preceded by any
 	 * number of fill bytes, which are bytes assigned code X’FF’. */
 
-	long start = ftell(stream), end;
+	size_t start = source_tell(source), end;
 
 	seek: do {
-		err = read_byte(stream, &byte);
+		err = read_byte(source, &byte);
 		RETURN_IF(err);
 	} while (byte != 0xff);
 
 	do {
-		err = read_byte(stream, &byte);
+		err = read_byte(source, &byte);
 		RETURN_IF(err);
 
 		switch (byte) {
@@ -209,9 +228,9 @@ int read_marker(FILE *stream, uint16_t *marker)
 			case 0x00:
 				goto seek;
 			default:
-				end = ftell(stream);
+				end = source_tell(source);
 				if (end - start != 2) {
-					printf("*** %li bytes skipped ***\n", end - start - 2);
+					msg_warn("*** %zu bytes skipped ***\n", end - start - 2);
 				}
 				*marker = UINT16_C(0xff00) | byte;
 				return RET_SUCCESS;
@@ -234,40 +253,41 @@ int write_marker(FILE *stream, uint16_t marker)
 	return RET_SUCCESS;
 }
 
-int skip_segment(FILE *stream, uint16_t len)
+int skip_segment(struct source *source, uint16_t len)
 {
-	if (fseek(stream, (long)len - 2, SEEK_CUR) != 0) {
-		return RET_FAILURE_FILE_SEEK;
+	if (len < 2) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
 	}
 
-	return RET_SUCCESS;
+	return source_skip(source, (size_t)len - 2);
 }
 
 /* F.1.2.3 Byte stuffing */
-int read_ecs_byte(FILE *stream, uint8_t *byte)
+int read_ecs_byte(struct source *source, uint8_t *byte)
 {
-	int err;
-	uint8_t b;
-
 	assert(byte != NULL);
 
-	err = read_byte(stream, &b);
-	RETURN_IF(err);
+	if (source_fill(source, 1)) {
+		return RET_FAILURE_FILE_IO;
+	}
+
+	uint8_t b = source->data[source->pos];
 
 	if (b == 0xff) {
-		err = read_byte(stream, &b);
-		RETURN_IF(err);
+		if (source_fill(source, 2)) {
+			return RET_FAILURE_FILE_IO;
+		}
 
-		if (b == 0x00) {
+		if (source->data[source->pos + 1] == 0x00) {
+			source->pos += 2;
 			*byte = 0xff;
 			return RET_SUCCESS;
 		} else {
-			if (fseek(stream, -2, SEEK_CUR) != 0) {
-				return RET_FAILURE_FILE_SEEK;
-			}
+			/* the marker is left for read_marker() */
 			return RET_FAILURE_NO_MORE_DATA;
 		}
 	} else {
+		source->pos++;
 		*byte = b;
 		return RET_SUCCESS;
 	}
@@ -288,3 +308,40 @@ int write_ecs_byte(FILE *stream, uint8_t byte)
 
 	return RET_SUCCESS;
 }
+
+/* the original standard output */
+static int stdout_fd = -1;
+
+int reserve_stdout(void)
+{
+	if (stdout_fd != -1) {
+		return RET_SUCCESS;
+	}
+
+	fflush(stdout);
+
+	stdout_fd = dup(STDOUT_FILENO);
+
+	if (stdout_fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+		return RET_FAILURE_FILE_IO;
+	}
+
+	return RET_SUCCESS;
+}
+
+FILE *open_output(const char *path)
+{
+	assert(path != NULL);
+
+	if (strcmp(path, "-") == 0) {
+		if (reserve_stdout()) {
+			return NULL;
+		}
+
+		int fd = dup(stdout_fd);
+
+		return fd < 0 ? NULL : fdopen(fd, "w");
+	}
+
+	return fopen(path, "w");
+}
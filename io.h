@@ -3,15 +3,21 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include "source.h"
 
 struct bits {
 	uint8_t byte;
 	size_t count;
+	/* output */
 	FILE *stream;
+	/* input */
+	struct source *source;
 };
 
 int init_bits(struct bits *bits, FILE *stream);
 
+int init_bits_source(struct bits *bits, struct source *source);
+
 /* F.2.2.5 The NEXTBIT procedure */
 int next_bit(struct bits *bits, uint8_t *bit);
 
@@ -20,31 +26,37 @@ int put_bit(struct bits *bits, uint8_t bit);
 /* align to byte boundary */
 int flush_bits(struct bits *bits);
 
-int read_nibbles(FILE *stream, uint8_t *first, uint8_t *second);
+int read_nibbles(struct source *source, uint8_t *first, uint8_t *second);
 
 int write_nibbles(FILE *stream, uint8_t first, uint8_t second);
 
-int read_byte(FILE *stream, uint8_t *byte);
+int read_byte(struct source *source, uint8_t *byte);
 
 int write_byte(FILE *stream, uint8_t byte);
 
-int read_word(FILE *stream, uint16_t *word);
+int read_word(struct source *source, uint16_t *word);
 
 int write_word(FILE *stream, uint16_t word);
 
-int read_length(FILE *stream, uint16_t *len);
+int read_length(struct source *source, uint16_t *len);
 
 int write_length(FILE *stream, uint16_t len);
 
-int skip_segment(FILE *stream, uint16_t len);
+int skip_segment(struct source *source, uint16_t len);
 
-int read_marker(FILE *stream, uint16_t *marker);
+int read_marker(struct source *source, uint16_t *marker);
 
 int write_marker(FILE *stream, uint16_t marker);
 
 /* read entropy-coded segment byte */
-int read_ecs_byte(FILE *stream, uint8_t *byte);
+int read_ecs_byte(struct source *source, uint8_t *byte);
 
 int write_ecs_byte(FILE *stream, uint8_t byte);
 
+/* move the messages printed to stdout to stderr, stdout is kept for the output data */
+int reserve_stdout(void);
+
+/* fopen() for writing, the path "-" stands for the (reserved) standard output */
+FILE *open_output(const char *path);
+
 #endif
@@ -0,0 +1,205 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "jpeg.h"
+#include "common.h"
+#include "frame.h"
+#include "source.h"
+#include "decode.h"
+#include "encode.h"
+#include "arena.h"
+
+void jpeg_init_params(struct jpeg_params *params)
+{
+	assert(params != NULL);
+
+	struct encoder_params encoder_params;
+
+	init_encoder_params(&encoder_params);
+
+	params->quality = encoder_params.q;
+	params->h = encoder_params.H;
+	params->v = encoder_params.V;
+	params->optimize = encoder_params.optimize;
+	params->threads = encoder_params.threads;
+	params->restart = encoder_params.restart;
+	params->arena = encoder_params.arena;
+}
+
+int jpeg_arena_create(struct arena **arena)
+{
+	return arena_create(arena);
+}
+
+int jpeg_arena_create_file(struct arena **arena, const char *dir)
+{
+	return arena_create_file(arena, dir);
+}
+
+void jpeg_arena_destroy(struct arena *arena)
+{
+	arena_destroy(arena);
+}
+
+int jpeg_decode(const void *data, size_t size, const struct jpeg_params *params, struct jpeg_image *image)
+{
+	int err;
+
+	assert(image != NULL);
+
+	struct decoder_params decoder_params;
+
+	init_decoder_params(&decoder_params);
+
+	if (params != NULL) {
+		decoder_params.threads = params->threads;
+		decoder_params.arena = params->arena;
+	}
+
+	struct source source;
+
+	source_init_memory(&source, data, size);
+
+	/* the decoder writes the PNM image into the buffer */
+	char *buffer = NULL;
+	size_t buffer_size = 0;
+	FILE *stream = open_memstream(&buffer, &buffer_size);
+
+	if (stream == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	struct decoder_output output = { NULL, stream };
+
+	err = process_jpeg_source(&source, &output, &decoder_params);
+
+	if (fclose(stream) != 0 && !err) {
+		err = RET_FAILURE_FILE_IO;
+	}
+
+	if (err) {
+		free(buffer);
+		return err;
+	}
+
+	/* the samples follow the header */
+	struct frame frame;
+	struct source pnm;
+
+	source_init_memory(&pnm, buffer, buffer_size);
+
+	err = read_frame_header(&frame, &pnm);
+
+	if (err) {
+		free(buffer);
+		return err;
+	}
+
+	image->width = frame.X;
+	image->height = frame.Y;
+	image->components = frame.components;
+	image->precision = frame.precision;
+	image->data = buffer + pnm.pos;
+	image->buffer = buffer;
+
+	return RET_SUCCESS;
+}
+
+void jpeg_free_image(struct jpeg_image *image)
+{
+	assert(image != NULL);
+
+	free(image->buffer);
+
+	image->data = NULL;
+	image->buffer = NULL;
+}
+
+int jpeg_encode(const struct jpeg_image *image, const struct jpeg_params *params, void **out, size_t *size)
+{
+	int err;
+
+	assert(image != NULL);
+	assert(params != NULL);
+	assert(out != NULL);
+	assert(size != NULL);
+
+	if (image->components != 1 && image->components != 3) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	if (image->precision < 1 || image->precision > 16) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	if (params->h < 1 || params->h > 2 || params->v < 1 || params->v > 2) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	struct encoder_params encoder_params;
+
+	init_encoder_params(&encoder_params);
+
+	encoder_params.q = params->quality;
+	encoder_params.H = params->h;
+	encoder_params.V = params->v;
+	encoder_params.optimize = params->optimize;
+	encoder_params.threads = params->threads;
+	encoder_params.restart = params->restart;
+	encoder_params.arena = params->arena;
+
+	encoder_params.raw = 1;
+	encoder_params.components = image->components;
+	encoder_params.Y = image->height;
+	encoder_params.X = image->width;
+	encoder_params.precision = image->precision;
+
+	size_t sample_size = image->precision > 8 ? 2 : 1;
+
+	struct source source;
+
+	source_init_memory(&source, image->data, sample_size * image->components * image->width * image->height);
+
+	/* the caller's buffer is filled afterwards, fmemopen() would overwrite its last byte by the NUL terminator */
+	char *buffer = NULL;
+	size_t buffer_size = 0;
+	FILE *stream = open_memstream(&buffer, &buffer_size);
+
+	if (stream == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	err = process_stream(&source, stream, &encoder_params);
+
+	if (fclose(stream) != 0 && !err) {
+		err = RET_FAILURE_FILE_IO;
+	}
+
+	if (err) {
+		free(buffer);
+		return err;
+	}
+
+	if (*out == NULL) {
+		*out = buffer;
+		*size = buffer_size;
+
+		return RET_SUCCESS;
+	}
+
+	if (buffer_size > *size) {
+		/* the size required */
+		*size = buffer_size;
+		free(buffer);
+		return RET_FAILURE_OVERFLOW_ERROR;
+	}
+
+	memcpy(*out, buffer, buffer_size);
+	*size = buffer_size;
+
+	free(buffer);
+
+	return RET_SUCCESS;
+}
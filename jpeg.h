@@ -0,0 +1,83 @@
+#ifndef JPEG_JPEG_H
+#define JPEG_JPEG_H
+
+/*
+ * In-memory interface of the library (libjpeg.a, libjpeg.so).
+ *
+ * The functions return 0 on success, and a non-zero error code otherwise.
+ * Nothing is printed.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Interleaved samples in the order of the binary PNM raster: one byte per
+ * sample for the precision up to 8 bits, otherwise two bytes (the most
+ * significant byte first).
+ */
+struct jpeg_image {
+	uint16_t width, height;
+
+	/* 1 (grayscale) or 3 (RGB) */
+	uint8_t components;
+
+	/* bits per sample */
+	uint8_t precision;
+
+	void *data;
+
+	/* allocated by jpeg_decode() */
+	void *buffer;
+};
+
+struct arena;
+
+struct jpeg_params {
+	/* quality 1..100 */
+	int quality;
+
+	/* luma subsampling factors, 1 or 2 */
+	uint8_t h, v;
+
+	/* 0 = default Huffman tables, 1 = optimized tables (K.2), 2 = optimal tables (package-merge) */
+	int optimize;
+
+	/* number of threads */
+	int threads;
+
+	/* encoder: restart interval in MCUs, 0 = no restart markers */
+	uint16_t restart;
+
+	/* memory reused by the successive calls, NULL = allocated per call */
+	struct arena *arena;
+};
+
+void jpeg_init_params(struct jpeg_params *params);
+
+/* the arena must not be used by two calls at once */
+int jpeg_arena_create(struct arena **arena);
+
+/* the arena is backed by temporary files in the directory, for the images larger than RAM */
+int jpeg_arena_create_file(struct arena **arena, const char *dir);
+
+void jpeg_arena_destroy(struct arena *arena);
+
+/* decode the codestream into the image, the params may be NULL */
+int jpeg_decode(const void *data, size_t size, const struct jpeg_params *params, struct jpeg_image *image);
+
+/* release the image filled by jpeg_decode() */
+void jpeg_free_image(struct jpeg_image *image);
+
+/*
+ * Encode the image into the codestream.
+ *
+ * When *out is NULL, the output buffer is allocated (to be released by
+ * free()). Otherwise, the codestream is written into the caller's buffer of
+ * *size bytes. On success, *size is set to the size of the codestream. When
+ * the caller's buffer is too small, RET_FAILURE_OVERFLOW_ERROR (0x3001) is
+ * returned, and *size is set to the size required.
+ */
+int jpeg_encode(const struct jpeg_image *image, const struct jpeg_params *params, void **out, size_t *size);
+
+#endif
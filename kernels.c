@@ -0,0 +1,82 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "kernels.h"
+
+enum {
+	ISA_SCALAR,
+	ISA_SSE2,
+	ISA_AVX2,
+	ISA_AVX512
+};
+
+static int detect_isa(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx512f")) {
+		return ISA_AVX512;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		return ISA_AVX2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return ISA_SSE2;
+	}
+#endif
+
+	return ISA_SCALAR;
+}
+
+/* the forced instruction set must not exceed the detected one */
+static int select_isa(void)
+{
+	int isa = detect_isa();
+	const char *env = getenv("JPEG_SIMD");
+
+	if (env == NULL) {
+		return isa;
+	}
+
+	if (strcmp(env, "scalar") == 0) {
+		return ISA_SCALAR;
+	}
+	if (strcmp(env, "sse2") == 0 && isa >= ISA_SSE2) {
+		return ISA_SSE2;
+	}
+	if (strcmp(env, "avx2") == 0 && isa >= ISA_AVX2) {
+		return ISA_AVX2;
+	}
+	if (strcmp(env, "avx512") == 0 && isa >= ISA_AVX512) {
+		return ISA_AVX512;
+	}
+
+	return isa;
+}
+
+/* the instruction set chosen by the first call, -1 = not yet */
+static int selected_isa = -1;
+
+const struct kernels *select_kernels(uint8_t P)
+{
+	/* the threads racing here pick the same one */
+	int isa = __atomic_load_n(&selected_isa, __ATOMIC_RELAXED);
+
+	if (isa < 0) {
+		isa = select_isa();
+		__atomic_store_n(&selected_isa, isa, __ATOMIC_RELAXED);
+	}
+
+	switch (isa) {
+		case ISA_AVX512:
+			return select_kernels_avx512(P);
+		case ISA_AVX2:
+			return select_kernels_avx2(P);
+		case ISA_SSE2:
+			return select_kernels_sse2(P);
+		default:
+			return select_kernels_scalar(P);
+	}
+}
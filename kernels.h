@@ -0,0 +1,59 @@
+#ifndef JPEG_KERNELS_H
+#define JPEG_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct flt_block;
+struct int_block;
+
+/*
+ * Set of compute kernels specialized for a particular sample precision.
+ *
+ * The precision is passed to each kernel anyway, the specialized variants
+ * simply ignore it and use a compile-time constant instead.
+ */
+struct kernels {
+	/* instruction set the kernels were compiled for */
+	const char *isa;
+
+	/* sample precision the kernels were compiled for, 0 means any */
+	uint8_t P;
+
+	/* IDCT followed by the level shift */
+	void (*inverse_dct_block)(struct flt_block *flt_block, uint8_t P);
+
+	/* level shift followed by FDCT */
+	void (*forward_dct_block)(struct flt_block *flt_block, uint8_t P);
+
+	/* in-place color conversion of a single line of interleaved samples */
+	void (*ycc_to_rgb_line)(float *line, size_t width, uint8_t P);
+	void (*ycck_to_rgb_line)(float *line, size_t width, uint8_t P);
+	void (*rgb_to_ycc_line)(float *line, size_t width, uint8_t P);
+
+	/* float samples (Nf per pixel) => PNM samples (components per pixel) */
+	void (*pack_line)(const float *in, void *out, size_t width, int Nf, int components, uint8_t P);
+
+	/* PNM samples => float samples */
+	void (*unpack_line)(const void *in, float *out, size_t width, int components, uint8_t P);
+
+	/* zig-zag reordering into z[], returns the mask of the nonzero AC coefficients (bit k for z[k]) */
+	uint64_t (*zigzag_block)(const struct int_block *int_block, int32_t z[64]);
+};
+
+/*
+ * choose the kernel set for given sample precision and the best instruction
+ * set supported by the CPU, the JPEG_SIMD environment variable can force
+ * one of "scalar", "sse2", "avx2", or "avx512"
+ */
+const struct kernels *select_kernels(uint8_t P);
+
+const struct kernels *select_kernels_scalar(uint8_t P);
+
+const struct kernels *select_kernels_sse2(uint8_t P);
+
+const struct kernels *select_kernels_avx2(uint8_t P);
+
+const struct kernels *select_kernels_avx512(uint8_t P);
+
+#endif
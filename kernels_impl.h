@@ -0,0 +1,313 @@
+/*
+ * Kernel template, included by kernels_<isa>.c with ISA defined.
+ *
+ * The translation unit is compiled with the instruction set flags of the
+ * particular ISA, so the loops below are vectorized accordingly. The loops
+ * the compiler does not vectorize use the intrinsics of the ISA, unless
+ * KERNEL_NO_INTRINSICS is defined.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include <arpa/inet.h>
+#if !defined(KERNEL_NO_INTRINSICS) && (defined(__SSE2__) || defined(__AVX2__) || defined(__AVX512F__))
+#	include <immintrin.h>
+#endif
+#include "kernels.h"
+#include "coeffs.h"
+#include "imgproc.h"
+
+#define KERNEL_CONCAT_(a, b) a##_##b
+#define KERNEL_CONCAT(a, b) KERNEL_CONCAT_(a, b)
+#define KERNEL(name) KERNEL_CONCAT(name, ISA)
+#define KERNEL_STR_(a) #a
+#define KERNEL_STR(a) KERNEL_STR_(a)
+
+static inline int clamp_(int min, int val, int max)
+{
+	if (val < min) {
+		return min;
+	}
+
+	if (val > max) {
+		return max;
+	}
+
+	return val;
+}
+
+/* out = a * b, the inner loop runs along the rows of b */
+static inline void matmul8(const float a[8][8], const float b[8][8], float out[8][8])
+{
+	for (int i = 0; i < 8; ++i) {
+		for (int j = 0; j < 8; ++j) {
+			out[i][j] = 0.f;
+		}
+		for (int k = 0; k < 8; ++k) {
+			for (int j = 0; j < 8; ++j) {
+				out[i][j] += a[i][k] * b[k][j];
+			}
+		}
+	}
+}
+
+/* B = M * B * M^T, where M[x][u] = lut[x][u] */
+static inline void idct_(struct flt_block *flt_block)
+{
+	float (*b)[8] = (float (*)[8])flt_block->c;
+	float t[8][8];
+
+	matmul8((const float (*)[8])b, (const float (*)[8])lut_t, t);
+	matmul8((const float (*)[8])lut, (const float (*)[8])t, b);
+}
+
+/* B = M^T * B * M */
+static inline void fdct_(struct flt_block *flt_block)
+{
+	float (*b)[8] = (float (*)[8])flt_block->c;
+	float t[8][8];
+
+	matmul8((const float (*)[8])b, (const float (*)[8])lut, t);
+	matmul8((const float (*)[8])lut_t, (const float (*)[8])t, b);
+}
+
+/*
+ * The generic kernels take the precision as a parameter. They are always
+ * inlined into the specialized variants below, so that the compiler can
+ * fold the level shift, the clamping range and the sample size.
+ */
+
+static inline void inverse_dct_block_(struct flt_block *flt_block, uint8_t P)
+{
+	int shift = 1 << (P - 1);
+
+	idct_(flt_block);
+
+	// level shift
+	for (int j = 0; j < 64; ++j) {
+		flt_block->c[j] += shift;
+	}
+}
+
+static inline void forward_dct_block_(struct flt_block *flt_block, uint8_t P)
+{
+	int shift = 1 << (P - 1);
+
+	// level shift
+	for (int j = 0; j < 64; ++j) {
+		flt_block->c[j] -= shift;
+	}
+
+	fdct_(flt_block);
+}
+
+static inline void ycc_to_rgb_line_(float *line, size_t width, uint8_t P)
+{
+	int shift = 1 << (P - 1);
+
+	for (size_t x = 0; x < width; ++x) {
+		float Y  = line[x * 3 + 0];
+		float Cb = line[x * 3 + 1];
+		float Cr = line[x * 3 + 2];
+
+		float R = Y + 1.402 * (Cr - shift);
+		float G = Y - 0.34414 * (Cb - shift) - 0.71414 * (Cr - shift);
+		float B = Y + 1.772 * (Cb - shift);
+
+		line[x * 3 + 0] = R;
+		line[x * 3 + 1] = G;
+		line[x * 3 + 2] = B;
+	}
+}
+
+static inline void ycck_to_rgb_line_(float *line, size_t width, uint8_t P)
+{
+	int shift = 1 << (P - 1);
+	int denom = 1 << P;
+
+	for (size_t x = 0; x < width; ++x) {
+		float Y_ = line[x * 4 + 0];
+		float Cb = line[x * 4 + 1];
+		float Cr = line[x * 4 + 2];
+		float K  = line[x * 4 + 3];
+
+		float C = Y_ + 1.402 * (Cr - shift);
+		float M = Y_ - 0.34414 * (Cb - shift) - 0.71414 * (Cr - shift);
+		float Y = Y_ + 1.772 * (Cb - shift);
+
+		float R = K - (C * K) / denom;
+		float G = K - (M * K) / denom;
+		float B = K - (Y * K) / denom;
+
+		line[x * 4 + 0] = R;
+		line[x * 4 + 1] = G;
+		line[x * 4 + 2] = B;
+		line[x * 4 + 3] = 0xff;
+	}
+}
+
+static inline void rgb_to_ycc_line_(float *line, size_t width, uint8_t P)
+{
+	int shift = 1 << (P - 1);
+
+	for (size_t x = 0; x < width; ++x) {
+		float R = line[x * 3 + 0];
+		float G = line[x * 3 + 1];
+		float B = line[x * 3 + 2];
+
+		float Y  = 0.299 * R + 0.587 * G + 0.114 * B;
+		float Cb = - 0.1687 * R - 0.3313 * G + 0.5 * B + shift;
+		float Cr = 0.5 * R - 0.4187 * G - 0.0813 * B + shift;
+
+		line[x * 3 + 0] = Y;
+		line[x * 3 + 1] = Cb;
+		line[x * 3 + 2] = Cr;
+	}
+}
+
+static inline void pack_line_(const float *in, void *out, size_t width, int Nf, int components, uint8_t P)
+{
+	int maxval = (1 << P) - 1;
+
+	if (maxval <= UINT8_MAX) {
+		uint8_t *out_ = out;
+		for (size_t x = 0; x < width; ++x) {
+			for (int c = 0; c < components; ++c) {
+				float sample = roundf(in[x * Nf + c]);
+				*out_++ = (uint8_t)clamp_(0, (int)sample, maxval);
+			}
+		}
+	} else {
+		uint16_t *out_ = out;
+		for (size_t x = 0; x < width; ++x) {
+			for (int c = 0; c < components; ++c) {
+				float sample = roundf(in[x * Nf + c]);
+				*out_++ = htons((uint16_t)clamp_(0, (int)sample, maxval));
+			}
+		}
+	}
+}
+
+static inline void unpack_line_(const void *in, float *out, size_t width, int components, uint8_t P)
+{
+	int maxval = (1 << P) - 1;
+
+	if (maxval <= UINT8_MAX) {
+		const uint8_t *in_ = in;
+		for (size_t x = 0; x < width; ++x) {
+			for (int c = 0; c < components; ++c) {
+				out[x * components + c] = (float)*in_++;
+			}
+		}
+	} else {
+		const uint16_t *in_ = in;
+		for (size_t x = 0; x < width; ++x) {
+			for (int c = 0; c < components; ++c) {
+				out[x * components + c] = (float)ntohs(*in_++);
+			}
+		}
+	}
+}
+
+/*
+ * The nonzero mask is built from the compares of 4, 8, or 16 coefficients
+ * at once, the zero runs of the AC coefficients are then the distances
+ * between its set bits. The precision does not matter here.
+ */
+static uint64_t KERNEL(zigzag_block)(const struct int_block *int_block, int32_t z[64])
+{
+	uint64_t mask = 0;
+
+	for (int i = 0; i < 64; ++i) {
+		z[i] = int_block->c[zigzag[i]];
+	}
+
+#if !defined(KERNEL_NO_INTRINSICS) && defined(__AVX512F__)
+	for (int i = 0; i < 64; i += 16) {
+		__m512i v = _mm512_loadu_si512((const void *)(z + i));
+
+		mask |= (uint64_t)_mm512_test_epi32_mask(v, v) << i;
+	}
+#elif !defined(KERNEL_NO_INTRINSICS) && defined(__AVX2__)
+	for (int i = 0; i < 64; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(z + i));
+		__m256i zero = _mm256_cmpeq_epi32(v, _mm256_setzero_si256());
+
+		mask |= (uint64_t)(~_mm256_movemask_ps(_mm256_castsi256_ps(zero)) & 0xff) << i;
+	}
+#elif !defined(KERNEL_NO_INTRINSICS) && defined(__SSE2__)
+	for (int i = 0; i < 64; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(z + i));
+		__m128i zero = _mm_cmpeq_epi32(v, _mm_setzero_si128());
+
+		mask |= (uint64_t)(~_mm_movemask_ps(_mm_castsi128_ps(zero)) & 0xf) << i;
+	}
+#else
+	for (int i = 0; i < 64; ++i) {
+		mask |= (uint64_t)(z[i] != 0) << i;
+	}
+#endif
+
+	/* the DC coefficient is coded separately */
+	return mask & ~(uint64_t)1;
+}
+
+/* instantiate the kernel set for precision PREC (0 = use the run-time value) */
+#define KERNELS(PREC) \
+	static void KERNEL(inverse_dct_block_##PREC)(struct flt_block *flt_block, uint8_t P) \
+	{ \
+		inverse_dct_block_(flt_block, PREC ? PREC : P); \
+	} \
+	static void KERNEL(forward_dct_block_##PREC)(struct flt_block *flt_block, uint8_t P) \
+	{ \
+		forward_dct_block_(flt_block, PREC ? PREC : P); \
+	} \
+	static void KERNEL(ycc_to_rgb_line_##PREC)(float *line, size_t width, uint8_t P) \
+	{ \
+		ycc_to_rgb_line_(line, width, PREC ? PREC : P); \
+	} \
+	static void KERNEL(ycck_to_rgb_line_##PREC)(float *line, size_t width, uint8_t P) \
+	{ \
+		ycck_to_rgb_line_(line, width, PREC ? PREC : P); \
+	} \
+	static void KERNEL(rgb_to_ycc_line_##PREC)(float *line, size_t width, uint8_t P) \
+	{ \
+		rgb_to_ycc_line_(line, width, PREC ? PREC : P); \
+	} \
+	static void KERNEL(pack_line_##PREC)(const float *in, void *out, size_t width, int Nf, int components, uint8_t P) \
+	{ \
+		pack_line_(in, out, width, Nf, components, PREC ? PREC : P); \
+	} \
+	static void KERNEL(unpack_line_##PREC)(const void *in, float *out, size_t width, int components, uint8_t P) \
+	{ \
+		unpack_line_(in, out, width, components, PREC ? PREC : P); \
+	} \
+	static const struct kernels KERNEL(kernels_##PREC) = { \
+		KERNEL_STR(ISA), \
+		PREC, \
+		KERNEL(inverse_dct_block_##PREC), \
+		KERNEL(forward_dct_block_##PREC), \
+		KERNEL(ycc_to_rgb_line_##PREC), \
+		KERNEL(ycck_to_rgb_line_##PREC), \
+		KERNEL(rgb_to_ycc_line_##PREC), \
+		KERNEL(pack_line_##PREC), \
+		KERNEL(unpack_line_##PREC), \
+		KERNEL(zigzag_block) \
+	};
+
+KERNELS(0)
+KERNELS(8)
+KERNELS(12)
+
+const struct kernels *KERNEL(select_kernels)(uint8_t P)
+{
+	switch (P) {
+		case 8:
+			return &KERNEL(kernels_8);
+		case 12:
+			return &KERNEL(kernels_12);
+		default:
+			return &KERNEL(kernels_0);
+	}
+}
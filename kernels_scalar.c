@@ -0,0 +1,4 @@
+#define ISA scalar
+/* x86-64 always has SSE2, the reference kernels must not use it */
+#define KERNEL_NO_INTRINSICS
+#include "kernels_impl.h"
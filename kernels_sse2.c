@@ -0,0 +1,2 @@
+#define ISA sse2
+#include "kernels_impl.h"
@@ -0,0 +1,216 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include "mem.h"
+#include "common.h"
+
+/* the size of a malloc'ed block precedes it, the malloc() alignment is kept */
+#define MEM_HEADER 16
+
+static const char *const category_to_str[MEM_CATEGORIES] = {
+	[MEM_COEFFS] = "coefficients",
+	[MEM_BLOCKS] = "float blocks",
+	[MEM_RASTERS] = "rasters",
+	[MEM_FRAME] = "frame",
+	[MEM_TOKENS] = "tokens",
+	[MEM_IO] = "I/O",
+	[MEM_OTHER] = "other"
+};
+
+/* accessed atomically */
+static size_t current[MEM_CATEGORIES];
+static size_t peak[MEM_CATEGORIES];
+static size_t total_current;
+static size_t total_peak;
+
+static size_t budget;
+
+static void update_peak(size_t *peak, size_t value)
+{
+	size_t old = __atomic_load_n(peak, __ATOMIC_RELAXED);
+
+	while (value > old && !__atomic_compare_exchange_n(peak, &old, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		;
+	}
+}
+
+void mem_set_budget(size_t size)
+{
+	budget = size;
+}
+
+int mem_charge(int category, size_t size)
+{
+	assert(category >= 0 && category < MEM_CATEGORIES);
+
+	size_t total = __atomic_add_fetch(&total_current, size, __ATOMIC_RELAXED);
+
+	if (budget != 0 && total > budget) {
+		__atomic_sub_fetch(&total_current, size, __ATOMIC_RELAXED);
+
+		msg_error("memory budget of %zu bytes exceeded: %zu more bytes of %s requested, %zu bytes in use\n",
+			budget, size, category_to_str[category], total - size);
+
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	update_peak(&total_peak, total);
+	update_peak(&peak[category], __atomic_add_fetch(&current[category], size, __ATOMIC_RELAXED));
+
+	return RET_SUCCESS;
+}
+
+void mem_release(int category, size_t size)
+{
+	assert(category >= 0 && category < MEM_CATEGORIES);
+
+	__atomic_sub_fetch(&current[category], size, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&total_current, size, __ATOMIC_RELAXED);
+}
+
+void *mem_malloc(int category, size_t size)
+{
+	/* the header would wrap the size around */
+	if (size > SIZE_MAX - MEM_HEADER) {
+		return NULL;
+	}
+
+	if (mem_charge(category, size)) {
+		return NULL;
+	}
+
+	uint8_t *ptr = malloc(MEM_HEADER + size);
+
+	if (ptr == NULL) {
+		mem_release(category, size);
+		return NULL;
+	}
+
+	*(size_t *)ptr = size;
+
+	return ptr + MEM_HEADER;
+}
+
+void *mem_calloc(int category, size_t size)
+{
+	void *ptr = mem_malloc(category, size);
+
+	if (ptr != NULL) {
+		memset(ptr, 0, size);
+	}
+
+	return ptr;
+}
+
+void *mem_realloc(int category, void *ptr, size_t size)
+{
+	if (ptr == NULL) {
+		return mem_malloc(category, size);
+	}
+
+	if (size > SIZE_MAX - MEM_HEADER) {
+		return NULL;
+	}
+
+	uint8_t *old = (uint8_t *)ptr - MEM_HEADER;
+	size_t old_size = *(size_t *)old;
+
+	/* the growth is charged before the block is moved */
+	if (size > old_size && mem_charge(category, size - old_size)) {
+		return NULL;
+	}
+
+	uint8_t *new = realloc(old, MEM_HEADER + size);
+
+	if (new == NULL) {
+		if (size > old_size) {
+			mem_release(category, size - old_size);
+		}
+		return NULL;
+	}
+
+	if (size < old_size) {
+		mem_release(category, old_size - size);
+	}
+
+	*(size_t *)new = size;
+
+	return new + MEM_HEADER;
+}
+
+void mem_free(int category, void *ptr)
+{
+	if (ptr == NULL) {
+		return;
+	}
+
+	uint8_t *old = (uint8_t *)ptr - MEM_HEADER;
+
+	mem_release(category, *(size_t *)old);
+
+	free(old);
+}
+
+void mem_report(FILE *stream)
+{
+	assert(stream != NULL);
+
+	fprintf(stream, "%-14s %14s %14s\n", "memory", "current", "peak");
+
+	for (int i = 0; i < MEM_CATEGORIES; ++i) {
+		fprintf(stream, "%-14s %14zu %14zu\n", category_to_str[i],
+			__atomic_load_n(&current[i], __ATOMIC_RELAXED), __atomic_load_n(&peak[i], __ATOMIC_RELAXED));
+	}
+
+	/* the peaks of the categories need not coincide */
+	fprintf(stream, "%-14s %14zu %14zu\n", "total",
+		__atomic_load_n(&total_current, __ATOMIC_RELAXED), __atomic_load_n(&total_peak, __ATOMIC_RELAXED));
+
+	if (budget != 0) {
+		fprintf(stream, "%-14s %14s %14zu\n", "budget", "", budget);
+	}
+}
+
+int mem_parse_size(const char *str, size_t *size)
+{
+	assert(str != NULL);
+	assert(size != NULL);
+
+	char *end;
+	unsigned long long value = strtoull(str, &end, 10);
+
+	if (end == str) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	int shift = 0;
+
+	switch (*end) {
+		case 'k':
+		case 'K':
+			shift = 10;
+			end++;
+			break;
+		case 'm':
+		case 'M':
+			shift = 20;
+			end++;
+			break;
+		case 'g':
+		case 'G':
+			shift = 30;
+			end++;
+			break;
+	}
+
+	if (*end != 0 || value > (SIZE_MAX >> shift)) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	*size = (size_t)value << shift;
+
+	return RET_SUCCESS;
+}
@@ -0,0 +1,47 @@
+#ifndef JPEG_MEM_H
+#define JPEG_MEM_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/* what the memory is used for */
+enum {
+	MEM_COEFFS,  /* quantized coefficients, dense or sparse */
+	MEM_BLOCKS,  /* floating-point blocks */
+	MEM_RASTERS, /* component rasters */
+	MEM_FRAME,   /* interleaved frame */
+	MEM_TOKENS,  /* entropy-coded tokens */
+	MEM_IO,      /* input window, output lines */
+	MEM_OTHER,   /* contexts, pipelines, threads */
+	MEM_CATEGORIES
+};
+
+/*
+ * Accounting of the allocations.
+ *
+ * The current and peak number of bytes is tracked for each category. When
+ * a budget is set, the allocation that would exceed it fails (with an
+ * error message). The functions may be called by any thread.
+ */
+
+/* 0 = unlimited */
+void mem_set_budget(size_t budget);
+
+/* count the bytes, fails with RET_FAILURE_MEMORY_ALLOCATION over the budget */
+int mem_charge(int category, size_t size);
+
+void mem_release(int category, size_t size);
+
+/* malloc(), calloc(), realloc() and free() with the accounting */
+void *mem_malloc(int category, size_t size);
+void *mem_calloc(int category, size_t size);
+void *mem_realloc(int category, void *ptr, size_t size);
+void mem_free(int category, void *ptr);
+
+/* print the table of the current and peak bytes */
+void mem_report(FILE *stream);
+
+/* parse the size with an optional K, M, or G suffix */
+int mem_parse_size(const char *str, size_t *size);
+
+#endif
@@ -0,0 +1,249 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include "pool.h"
+#include "common.h"
+#include "mem.h"
+
+/* chunks [next, end) not yet taken, owned by one thread */
+struct share {
+	size_t next; /* accessed atomically */
+	size_t end;
+};
+
+struct pool {
+	int threads;
+
+	pthread_t *thread;
+
+	pthread_mutex_t mutex;
+	/* signals a new job or the shutdown */
+	pthread_cond_t cond_job;
+	/* signals that the last worker finished the job */
+	pthread_cond_t cond_done;
+
+	unsigned long generation;
+	int shutdown;
+	/* workers still running the current job */
+	int active;
+
+	/* the current job */
+	pool_func func;
+	void *arg;
+	size_t count;
+	size_t grain;
+
+	/* one per thread, index 0 belongs to the caller of pool_for() */
+	struct share *share;
+};
+
+struct worker {
+	struct pool *pool;
+	int index;
+};
+
+static void run_chunk(struct pool *pool, size_t chunk)
+{
+	size_t begin = chunk * pool->grain;
+	size_t end = begin + pool->grain;
+
+	if (end > pool->count) {
+		end = pool->count;
+	}
+
+	pool->func(pool->arg, begin, end);
+}
+
+/* process own share first, then steal from the others */
+static void run_job(struct pool *pool, int index)
+{
+	for (int i = 0; i < pool->threads; ++i) {
+		struct share *share = &pool->share[(index + i) % pool->threads];
+
+		while (1) {
+			size_t chunk = __atomic_fetch_add(&share->next, 1, __ATOMIC_RELAXED);
+
+			if (chunk >= share->end) {
+				break;
+			}
+
+			run_chunk(pool, chunk);
+		}
+	}
+}
+
+static void *worker_main(void *arg)
+{
+	struct worker *worker = arg;
+	struct pool *pool = worker->pool;
+	int index = worker->index;
+	unsigned long generation = 0;
+
+	mem_free(MEM_OTHER, worker);
+
+	pthread_mutex_lock(&pool->mutex);
+
+	while (1) {
+		while (!pool->shutdown && pool->generation == generation) {
+			pthread_cond_wait(&pool->cond_job, &pool->mutex);
+		}
+
+		if (pool->shutdown) {
+			break;
+		}
+
+		generation = pool->generation;
+
+		pthread_mutex_unlock(&pool->mutex);
+
+		run_job(pool, index);
+
+		pthread_mutex_lock(&pool->mutex);
+
+		if (--pool->active == 0) {
+			pthread_cond_signal(&pool->cond_done);
+		}
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	return NULL;
+}
+
+int pool_create(struct pool **pool_, int threads)
+{
+	assert(pool_ != NULL);
+
+	if (threads < 1) {
+		threads = 1;
+	}
+
+	struct pool *pool = mem_malloc(MEM_OTHER, sizeof(struct pool));
+
+	if (pool == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	pool->threads = threads;
+	pool->generation = 0;
+	pool->shutdown = 0;
+	pool->active = 0;
+
+	pool->thread = mem_malloc(MEM_OTHER, sizeof(pthread_t) * threads);
+	pool->share = mem_malloc(MEM_OTHER, sizeof(struct share) * threads);
+
+	if (pool->thread == NULL || pool->share == NULL) {
+		mem_free(MEM_OTHER, pool->thread);
+		mem_free(MEM_OTHER, pool->share);
+		mem_free(MEM_OTHER, pool);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->cond_job, NULL);
+	pthread_cond_init(&pool->cond_done, NULL);
+
+	/* thread 0 is the caller */
+	for (int i = 1; i < threads; ++i) {
+		struct worker *worker = mem_malloc(MEM_OTHER, sizeof(struct worker));
+
+		if (worker == NULL) {
+			pool->threads = i;
+			pool_destroy(pool);
+			return RET_FAILURE_MEMORY_ALLOCATION;
+		}
+
+		worker->pool = pool;
+		worker->index = i;
+
+		if (pthread_create(&pool->thread[i], NULL, worker_main, worker) != 0) {
+			mem_free(MEM_OTHER, worker);
+			pool->threads = i;
+			pool_destroy(pool);
+			return RET_FAILURE_LOGIC_ERROR;
+		}
+	}
+
+	*pool_ = pool;
+
+	return RET_SUCCESS;
+}
+
+void pool_destroy(struct pool *pool)
+{
+	if (pool == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->cond_job);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (int i = 1; i < pool->threads; ++i) {
+		pthread_join(pool->thread[i], NULL);
+	}
+
+	pthread_cond_destroy(&pool->cond_done);
+	pthread_cond_destroy(&pool->cond_job);
+	pthread_mutex_destroy(&pool->mutex);
+
+	mem_free(MEM_OTHER, pool->share);
+	mem_free(MEM_OTHER, pool->thread);
+	mem_free(MEM_OTHER, pool);
+}
+
+int pool_threads(struct pool *pool)
+{
+	return pool != NULL ? pool->threads : 1;
+}
+
+void pool_for(struct pool *pool, size_t count, size_t grain, pool_func func, void *arg)
+{
+	assert(func != NULL);
+
+	if (count == 0) {
+		return;
+	}
+
+	if (grain == 0) {
+		grain = 1;
+	}
+
+	size_t chunks = ceil_div(count, grain);
+
+	if (pool == NULL || pool->threads == 1 || chunks == 1) {
+		func(arg, 0, count);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+
+	pool->func = func;
+	pool->arg = arg;
+	pool->count = count;
+	pool->grain = grain;
+
+	/* split the chunks evenly */
+	for (int i = 0; i < pool->threads; ++i) {
+		pool->share[i].next = chunks * i / pool->threads;
+		pool->share[i].end = chunks * (i + 1) / pool->threads;
+	}
+
+	pool->active = pool->threads - 1;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->cond_job);
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	run_job(pool, 0);
+
+	pthread_mutex_lock(&pool->mutex);
+
+	while (pool->active > 0) {
+		pthread_cond_wait(&pool->cond_done, &pool->mutex);
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,28 @@
+#ifndef JPEG_POOL_H
+#define JPEG_POOL_H
+
+#include <stddef.h>
+
+/* process the items [begin, end) */
+typedef void (*pool_func)(void *arg, size_t begin, size_t end);
+
+struct pool;
+
+/* create the pool of threads, the calling thread counts as one of them */
+int pool_create(struct pool **pool, int threads);
+
+void pool_destroy(struct pool *pool);
+
+int pool_threads(struct pool *pool);
+
+/*
+ * Run func over the items [0, count) in chunks of (at most) grain items.
+ *
+ * The chunks are initially split evenly among the threads. Each thread
+ * processes its own share first, and then steals the remaining chunks from
+ * the others. Returns when all the items have been processed. When the pool
+ * is NULL, the items are processed by the calling thread.
+ */
+void pool_for(struct pool *pool, size_t count, size_t grain, pool_func func, void *arg);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef JPEG_PROBES_H
+#define JPEG_PROBES_H
+
+/*
+ * USDT probes of the provider "jpeg", for bpftrace, perf, or SystemTap, e.g.
+ *
+ *   bpftrace -e 'usdt:./decoder:jpeg:read_ecs__start { @t = nsecs; }
+ *                usdt:./decoder:jpeg:read_ecs__done { @ns = hist(nsecs - @t); }'
+ *
+ * A probe is a nop in the code and a note in the ELF file, the arguments
+ * are only read when a tracer is attached. The notes are listed by
+ * readelf -n. The probes are compiled in on x86-64 ELF targets with GCC or
+ * Clang, and compiled out with JPEG_NO_PROBES (make PROBES=0).
+ *
+ * image__start(tool)                     "decoder" or "encoder"
+ * image__done(tool, err, X, Y)
+ * marker(marker, offset)                 each marker read by parse_format()
+ * restart(m, mcu)                        RSTm read or written
+ * <stage>__start(), <stage>__done(err)   read_ecs, dequantize, inverse_dct,
+ *                                        write_image, tokenize_ecs, write_ecs
+ *
+ * Each argument is passed as a signed 64-bit integer, the strings as their
+ * address (str(arg0) in bpftrace).
+ */
+
+#if defined(__GNUC__) && defined(__ELF__) && defined(__x86_64__) && !defined(JPEG_NO_PROBES)
+#	define JPEG_PROBES
+#endif
+
+#ifdef JPEG_PROBES
+/*
+ * The note is the one emitted by <sys/sdt.h> (type 3, owner "stapsdt"):
+ * the address of the nop, the address of .stapsdt.base, no semaphore, the
+ * provider, the name, and the arguments as "size@operand". The header
+ * itself is not required.
+ */
+#	define PROBE_NOTE(name, args) \
+		"990: nop\n" \
+		".pushsection .note.stapsdt,\"\",\"note\"\n" \
+		".balign 4\n" \
+		".4byte 992f-991f, 994f-993f, 3\n" \
+		"991: .asciz \"stapsdt\"\n" \
+		"992: .balign 4\n" \
+		"993: .8byte 990b\n" \
+		".8byte _.stapsdt.base\n" \
+		".8byte 0\n" \
+		".asciz \"jpeg\"\n" \
+		".asciz \"" #name "\"\n" \
+		".asciz \"" args "\"\n" \
+		"994: .balign 4\n" \
+		".popsection\n" \
+		".ifndef _.stapsdt.base\n" \
+		".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+		".weak _.stapsdt.base\n" \
+		".hidden _.stapsdt.base\n" \
+		"_.stapsdt.base: .space 1\n" \
+		".size _.stapsdt.base, 1\n" \
+		".popsection\n" \
+		".endif\n"
+#	define PROBE_ARG(a) "nor" ((long)(a))
+#	define PROBE0(name) \
+		do { \
+			__asm__ __volatile__ (PROBE_NOTE(name, "") : : ); \
+		} while (0)
+#	define PROBE1(name, a) \
+		do { \
+			__asm__ __volatile__ (PROBE_NOTE(name, "-8@%0") : : PROBE_ARG(a)); \
+		} while (0)
+#	define PROBE2(name, a, b) \
+		do { \
+			__asm__ __volatile__ (PROBE_NOTE(name, "-8@%0 -8@%1") : : PROBE_ARG(a), PROBE_ARG(b)); \
+		} while (0)
+#	define PROBE4(name, a, b, c, d) \
+		do { \
+			__asm__ __volatile__ (PROBE_NOTE(name, "-8@%0 -8@%1 -8@%2 -8@%3") : : PROBE_ARG(a), PROBE_ARG(b), PROBE_ARG(c), PROBE_ARG(d)); \
+		} while (0)
+#else
+#	define PROBE0(name) do { } while (0)
+#	define PROBE1(name, a) do { (void)(a); } while (0)
+#	define PROBE2(name, a, b) do { (void)(a); (void)(b); } while (0)
+#	define PROBE4(name, a, b, c, d) do { (void)(a); (void)(b); (void)(c); (void)(d); } while (0)
+#endif
+
+#endif
@@ -0,0 +1,180 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <sched.h>
+#include "ring.h"
+#include "common.h"
+#include "mem.h"
+
+/* the polls before the thread goes to sleep */
+#define RING_SPIN 64
+
+int ring_init(struct ring *ring, size_t size)
+{
+	assert(ring != NULL);
+
+	size_t s = 1;
+
+	while (s < size) {
+		s <<= 1;
+	}
+
+	ring->slot = mem_malloc(MEM_OTHER, sizeof(size_t) * s);
+
+	if (ring->slot == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	ring->size = s;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->closed = 0;
+
+	ring->consumers_waiting = 0;
+	ring->producer_waiting = 0;
+
+	pthread_mutex_init(&ring->mutex, NULL);
+	pthread_cond_init(&ring->not_empty, NULL);
+	pthread_cond_init(&ring->not_full, NULL);
+
+	return RET_SUCCESS;
+}
+
+void ring_free(struct ring *ring)
+{
+	assert(ring != NULL);
+
+	pthread_cond_destroy(&ring->not_full);
+	pthread_cond_destroy(&ring->not_empty);
+	pthread_mutex_destroy(&ring->mutex);
+
+	mem_free(MEM_OTHER, ring->slot);
+}
+
+/*
+ * The sleeper announces itself in *waiting before it checks the condition
+ * again under the lock, the other side changes the state before it reads
+ * *waiting (both sequentially consistent). So either the sleeper sees the
+ * change, or it is signaled under the lock.
+ */
+static void wake(struct ring *ring, int *waiting, pthread_cond_t *cond, int all)
+{
+	if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST) == 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&ring->mutex);
+
+	if (all) {
+		pthread_cond_broadcast(cond);
+	} else {
+		pthread_cond_signal(cond);
+	}
+
+	pthread_mutex_unlock(&ring->mutex);
+}
+
+static int is_full(struct ring *ring, size_t head)
+{
+	return head - __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) >= ring->size;
+}
+
+/* and not closed */
+static int is_empty(struct ring *ring)
+{
+	size_t head = __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST);
+
+	return __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) == head && !__atomic_load_n(&ring->closed, __ATOMIC_SEQ_CST);
+}
+
+void ring_push(struct ring *ring, size_t index)
+{
+	assert(ring != NULL);
+
+	size_t head = ring->head;
+
+	for (int spin = 0; is_full(ring, head); ++spin) {
+		if (spin < RING_SPIN) {
+			sched_yield();
+			continue;
+		}
+
+		pthread_mutex_lock(&ring->mutex);
+		__atomic_add_fetch(&ring->producer_waiting, 1, __ATOMIC_SEQ_CST);
+
+		while (is_full(ring, head)) {
+			pthread_cond_wait(&ring->not_full, &ring->mutex);
+		}
+
+		__atomic_sub_fetch(&ring->producer_waiting, 1, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&ring->mutex);
+	}
+
+	/* the consumers read the slot with atomic loads as well */
+	__atomic_store_n(&ring->slot[head & (ring->size - 1)], index, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+
+	wake(ring, &ring->consumers_waiting, &ring->not_empty, 0);
+}
+
+void ring_close(struct ring *ring)
+{
+	assert(ring != NULL);
+
+	__atomic_store_n(&ring->closed, 1, __ATOMIC_SEQ_CST);
+
+	wake(ring, &ring->consumers_waiting, &ring->not_empty, 1);
+}
+
+int ring_pop(struct ring *ring, size_t *index)
+{
+	assert(ring != NULL);
+	assert(index != NULL);
+
+	size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	int spin = 0;
+
+	while (1) {
+		int closed = __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE);
+		size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+		if (tail == head) {
+			/* empty */
+			if (closed) {
+				return RET_FAILURE_NO_MORE_DATA;
+			}
+
+			if (spin++ < RING_SPIN) {
+				sched_yield();
+			} else {
+				pthread_mutex_lock(&ring->mutex);
+				__atomic_add_fetch(&ring->consumers_waiting, 1, __ATOMIC_SEQ_CST);
+
+				while (is_empty(ring)) {
+					pthread_cond_wait(&ring->not_empty, &ring->mutex);
+				}
+
+				__atomic_sub_fetch(&ring->consumers_waiting, 1, __ATOMIC_SEQ_CST);
+				pthread_mutex_unlock(&ring->mutex);
+
+				spin = 0;
+			}
+
+			tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+			continue;
+		}
+
+		/* the value may be stale when another consumer takes the slot, the exchange fails then */
+		size_t value = __atomic_load_n(&ring->slot[tail & (ring->size - 1)], __ATOMIC_RELAXED);
+
+		/* on failure, tail is updated to the current value */
+		if (__atomic_compare_exchange_n(&ring->tail, &tail, tail + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)) {
+			*index = value;
+
+			wake(ring, &ring->producer_waiting, &ring->not_full, 0);
+
+			return RET_SUCCESS;
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#ifndef JPEG_RING_H
+#define JPEG_RING_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+/*
+ * Lock-free ring of indices with a single producer.
+ *
+ * Any number of consumers may pop the published indices, each index is
+ * delivered to exactly one of them. A thread waiting on an empty (or full)
+ * ring spins briefly, then sleeps until it is woken up by the other side;
+ * the lock is only taken when someone sleeps.
+ */
+struct ring {
+	size_t *slot;
+	/* power of two */
+	size_t size;
+
+	/* next slot to be written, advanced by the producer */
+	size_t head;
+	/* next slot to be read, advanced by the consumers */
+	size_t tail;
+
+	/* no more indices will be pushed */
+	int closed;
+
+	/* the sleeping consumers, and the sleeping producer */
+	int consumers_waiting;
+	int producer_waiting;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+};
+
+int ring_init(struct ring *ring, size_t size);
+
+void ring_free(struct ring *ring);
+
+/* producer: publish the index, waits while the ring is full */
+void ring_push(struct ring *ring, size_t index);
+
+/* producer: wake up consumers waiting on an empty ring */
+void ring_close(struct ring *ring);
+
+/* consumer: returns RET_FAILURE_NO_MORE_DATA once the ring is closed and empty */
+int ring_pop(struct ring *ring, size_t *index);
+
+#endif
@@ -0,0 +1,201 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "source.h"
+#include "common.h"
+#include "mem.h"
+
+/* initial size of the stream window */
+#define SOURCE_WINDOW 65536
+
+int source_open(struct source *source, const char *path)
+{
+	assert(source != NULL);
+	assert(path != NULL);
+
+	source_init_memory(source, NULL, 0);
+
+	int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+
+	if (fd < 0) {
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (map != MAP_FAILED) {
+			/* parsed front to back */
+			madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+			source->map = map;
+			source->map_size = (size_t)st.st_size;
+			source->data = map;
+			source->size = (size_t)st.st_size;
+
+			if (fd != STDIN_FILENO) {
+				close(fd);
+			}
+
+			return RET_SUCCESS;
+		}
+	}
+
+	/* stream through the window */
+	source->buffer = mem_malloc(MEM_IO, SOURCE_WINDOW);
+
+	if (source->buffer == NULL) {
+		if (fd != STDIN_FILENO) {
+			close(fd);
+		}
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	source->capacity = SOURCE_WINDOW;
+	source->data = source->buffer;
+	source->fd = fd;
+
+	return RET_SUCCESS;
+}
+
+void source_init_memory(struct source *source, const void *data, size_t size)
+{
+	assert(source != NULL);
+
+	source->data = data;
+	source->size = size;
+	source->pos = 0;
+	source->base = 0;
+	source->fd = -1;
+	source->map = NULL;
+	source->map_size = 0;
+	source->buffer = NULL;
+	source->capacity = 0;
+}
+
+void source_close(struct source *source)
+{
+	assert(source != NULL);
+
+	if (source->map != NULL) {
+		munmap(source->map, source->map_size);
+	}
+
+	if (source->fd >= 0 && source->fd != STDIN_FILENO) {
+		close(source->fd);
+	}
+
+	mem_free(MEM_IO, source->buffer);
+
+	source_init_memory(source, NULL, 0);
+}
+
+int source_fill(struct source *source, size_t n)
+{
+	assert(source != NULL);
+
+	if (source->size - source->pos >= n) {
+		return RET_SUCCESS;
+	}
+
+	if (source->fd < 0) {
+		return RET_FAILURE_FILE_IO;
+	}
+
+	/* discard the consumed bytes */
+	size_t remaining = source->size - source->pos;
+
+	memmove(source->buffer, source->buffer + source->pos, remaining);
+
+	source->base += source->pos;
+	source->pos = 0;
+	source->size = remaining;
+
+	if (source->capacity < n) {
+		size_t capacity = source->capacity * 2 > n ? source->capacity * 2 : n;
+		uint8_t *buffer = mem_realloc(MEM_IO, source->buffer, capacity);
+
+		if (buffer == NULL) {
+			return RET_FAILURE_MEMORY_ALLOCATION;
+		}
+
+		source->buffer = buffer;
+		source->capacity = capacity;
+	}
+
+	source->data = source->buffer;
+
+	while (source->size < n) {
+		ssize_t r = read(source->fd, source->buffer + source->size, source->capacity - source->size);
+
+		if (r < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (r <= 0) {
+			return RET_FAILURE_FILE_IO;
+		}
+
+		source->size += (size_t)r;
+	}
+
+	return RET_SUCCESS;
+}
+
+int source_read(struct source *source, void *buf, size_t n)
+{
+	int err;
+
+	assert(source != NULL);
+
+	err = source_fill(source, n);
+	RETURN_IF(err);
+
+	memcpy(buf, source->data + source->pos, n);
+
+	source->pos += n;
+
+	return RET_SUCCESS;
+}
+
+int source_skip(struct source *source, size_t n)
+{
+	int err;
+
+	assert(source != NULL);
+
+	/* without growing the window */
+	while (n > source->size - source->pos) {
+		n -= source->size - source->pos;
+		source->pos = source->size;
+
+		err = source_fill(source, 1);
+		RETURN_IF(err);
+	}
+
+	source->pos += n;
+
+	return RET_SUCCESS;
+}
+
+size_t source_drain(struct source *source)
+{
+	assert(source != NULL);
+
+	size_t n = 0;
+
+	do {
+		n += source->size - source->pos;
+		source->pos = source->size;
+	} while (source_fill(source, 1) == RET_SUCCESS);
+
+	return n;
+}
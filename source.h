@@ -0,0 +1,80 @@
+#ifndef JPEG_SOURCE_H
+#define JPEG_SOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Input data accessed through a pointer.
+ *
+ * The data are either a memory-mapped file, a buffer supplied by the
+ * caller, or a window into a stream that cannot be mapped (e.g. a pipe).
+ * The window is refilled on demand by source_fill(), the consumed bytes are
+ * discarded, so the stream is never seeked.
+ */
+struct source {
+	const uint8_t *data;
+	/* number of valid bytes in data[] */
+	size_t size;
+
+	/* offset of the next byte in data[] */
+	size_t pos;
+
+	/* offset of data[0] in the input */
+	size_t base;
+
+	/* the stream behind the window, or -1 */
+	int fd;
+
+	/* released by source_close() */
+	void *map;
+	size_t map_size;
+	uint8_t *buffer;
+	size_t capacity;
+};
+
+/* the path "-" stands for the standard input */
+int source_open(struct source *source, const char *path);
+
+/* the data must outlive the source */
+void source_init_memory(struct source *source, const void *data, size_t size);
+
+void source_close(struct source *source);
+
+/* make at least n bytes available at data[pos], fails at the end of the input */
+int source_fill(struct source *source, size_t n);
+
+/* copy n bytes from the source */
+int source_read(struct source *source, void *buf, size_t n);
+
+int source_skip(struct source *source, size_t n);
+
+/* consume the rest of the input, returns the number of bytes */
+size_t source_drain(struct source *source);
+
+/* offset of the next byte in the input */
+static inline size_t source_tell(const struct source *source)
+{
+	return source->base + source->pos;
+}
+
+/* the next byte, or -1 at the end of the input */
+static inline int source_peek(struct source *source)
+{
+	if (source->pos == source->size && source_fill(source, 1)) {
+		return -1;
+	}
+
+	return source->data[source->pos];
+}
+
+static inline int source_getc(struct source *source)
+{
+	if (source->pos == source->size && source_fill(source, 1)) {
+		return -1;
+	}
+
+	return source->data[source->pos++];
+}
+
+#endif
@@ -0,0 +1,130 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <assert.h>
+#include <time.h>
+#include "stats.h"
+#include "common.h"
+
+static const char *const stage_to_str[STAGES] = {
+	[STAGE_MARKERS] = "markers",
+	[STAGE_ENTROPY] = "entropy",
+	[STAGE_QUANTIZATION] = "quantization",
+	[STAGE_DCT] = "dct",
+	[STAGE_BLOCKS] = "blocks",
+	[STAGE_SAMPLING] = "sampling",
+	[STAGE_COLOR] = "color",
+	[STAGE_PNM] = "pnm"
+};
+
+static uint64_t now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+void stats_init(struct stats *stats)
+{
+	assert(stats != NULL);
+
+	for (int i = 0; i < STAGES; ++i) {
+		stats->time[i] = 0;
+	}
+
+	stats->stage = -1;
+	stats->since = 0;
+
+	stats->bytes_in = 0;
+	stats->bytes_out = -1;
+
+	stats->mcus = 0;
+	stats->blocks = 0;
+	stats->pixels = 0;
+}
+
+void stats_stage(struct stats *stats, int stage)
+{
+	if (stats == NULL) {
+		return;
+	}
+
+	assert(stage >= 0 && stage < STAGES);
+
+	uint64_t t = now();
+
+	if (stats->stage >= 0) {
+		stats->time[stats->stage] += t - stats->since;
+	}
+
+	stats->stage = stage;
+	stats->since = t;
+}
+
+void stats_stop(struct stats *stats)
+{
+	if (stats == NULL || stats->stage < 0) {
+		return;
+	}
+
+	stats->time[stats->stage] += now() - stats->since;
+
+	stats->stage = -1;
+}
+
+void stats_count(struct stats *stats, const struct context *context)
+{
+	if (stats == NULL) {
+		return;
+	}
+
+	assert(context != NULL);
+
+	stats->mcus = (uint64_t)context->m_x * context->m_y;
+
+	stats->blocks = 0;
+	for (int i = 0; i < context->Nf; ++i) {
+		stats->blocks += (uint64_t)context->component[i].b_x * context->component[i].b_y;
+	}
+
+	stats->pixels = (uint64_t)context->X * context->Y;
+}
+
+void stats_write_json(const struct stats *stats, const char *tool, FILE *stream)
+{
+	assert(stats != NULL);
+	assert(tool != NULL);
+	assert(stream != NULL);
+
+	uint64_t total = 0;
+
+	for (int i = 0; i < STAGES; ++i) {
+		total += stats->time[i];
+	}
+
+	fprintf(stream, "{\"tool\":\"%s\",\"stages_ns\":{", tool);
+
+	for (int i = 0; i < STAGES; ++i) {
+		fprintf(stream, "%s\"%s\":%" PRIu64, i ? "," : "", stage_to_str[i], stats->time[i]);
+	}
+
+	fprintf(stream, "},\"total_ns\":%" PRIu64 ",\"bytes_in\":%" PRIu64 ",", total, stats->bytes_in);
+
+	if (stats->bytes_out >= 0) {
+		fprintf(stream, "\"bytes_out\":%" PRId64 ",", stats->bytes_out);
+	} else {
+		fprintf(stream, "\"bytes_out\":null,");
+	}
+
+	fprintf(stream, "\"mcus\":%" PRIu64 ",\"blocks\":%" PRIu64 ",\"pixels\":%" PRIu64 ",", stats->mcus, stats->blocks, stats->pixels);
+
+	/* bytes per ns = 1e3 MB/s, pixels per ns = 1e3 Mpix/s */
+	double seconds = (double)total * 1e-9;
+
+	fprintf(stream, "\"mb_per_s\":%.3f,\"mpix_per_s\":%.3f}\n",
+		total ? (double)stats->bytes_in * 1e-6 / seconds : 0.,
+		total ? (double)stats->pixels * 1e-6 / seconds : 0.);
+}
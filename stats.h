@@ -0,0 +1,60 @@
+#ifndef JPEG_STATS_H
+#define JPEG_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+struct context;
+
+enum {
+	STAGE_MARKERS,      /* marker segments */
+	STAGE_ENTROPY,      /* entropy decoding or encoding */
+	STAGE_QUANTIZATION, /* dequantization or quantization */
+	STAGE_DCT,          /* IDCT or FDCT */
+	STAGE_BLOCKS,       /* blocks to rasters or back */
+	STAGE_SAMPLING,     /* upsampling or downsampling */
+	STAGE_COLOR,        /* color conversion */
+	STAGE_PNM,          /* PNM input or output */
+	STAGES
+};
+
+/*
+ * Wall-clock time of the stages, as seen by the calling thread.
+ *
+ * The time between two stats_stage() calls is charged to the stage of the
+ * former call. The work of the pipeline threads overlaps the entropy
+ * coding and is charged to it.
+ */
+struct stats {
+	/* nanoseconds */
+	uint64_t time[STAGES];
+
+	/* the stage being timed (-1 = none), and since when */
+	int stage;
+	uint64_t since;
+
+	uint64_t bytes_in;
+	/* -1 when the output is not seekable */
+	int64_t bytes_out;
+
+	uint64_t mcus;
+	uint64_t blocks;
+	uint64_t pixels;
+};
+
+void stats_init(struct stats *stats);
+
+/* switch to the stage, nothing is done for NULL stats */
+void stats_stage(struct stats *stats, int stage);
+
+/* stop the timing */
+void stats_stop(struct stats *stats);
+
+/* the counts of the image in the context */
+void stats_count(struct stats *stats, const struct context *context);
+
+/* a single JSON object on a line */
+void stats_write_json(const struct stats *stats, const char *tool, FILE *stream);
+
+#endif
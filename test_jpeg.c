@@ -0,0 +1,155 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jpeg.h"
+#include "common.h"
+#include "huffman.h"
+#include "mjpeg.h"
+#include "mem.h"
+
+/*
+ * Checks of the library interface, run by make check.
+ */
+
+#define WIDTH 64
+#define HEIGHT 48
+
+static int failures;
+
+static void check(int cond, const char *what)
+{
+	if (!cond) {
+		fprintf(stderr, "FAILED: %s\n", what);
+		failures++;
+	}
+}
+
+/* jpeg_encode() into the caller's buffer of the codestream size + delta bytes */
+static void check_caller_buffer(const struct jpeg_image *image, const struct jpeg_params *params, const uint8_t *ref, size_t ref_size, int delta)
+{
+	size_t capacity = ref_size + delta;
+	uint8_t *buffer = malloc(capacity + 1);
+
+	if (buffer == NULL) {
+		check(0, "malloc");
+		return;
+	}
+
+	/* the guard byte past the buffer */
+	memset(buffer, 0xaa, capacity + 1);
+
+	void *out = buffer;
+	size_t size = capacity;
+	int err = jpeg_encode(image, params, &out, &size);
+
+	if (delta < 0) {
+		check(err != 0, "smaller buffer: an error returned");
+		check(size == ref_size, "smaller buffer: the size required reported");
+	} else {
+		check(err == 0, "larger or exact buffer: success");
+		check(size == ref_size, "larger or exact buffer: the codestream size");
+		check(memcmp(buffer, ref, ref_size) == 0, "larger or exact buffer: the codestream");
+		check(buffer[ref_size - 2] == 0xff && buffer[ref_size - 1] == 0xd9, "larger or exact buffer: EOI at the end");
+	}
+
+	check(buffer[capacity] == 0xaa, "nothing written past the buffer");
+
+	free(buffer);
+}
+
+/* the code tables in mjpeg.h are those derived from the Huffman tables there */
+static void check_mjpeg_hcode(const struct htable *htable, const struct hcode *expected, const char *what)
+{
+	struct htable source = *htable;
+	struct hcode hcode;
+
+	/* the entries past the last code are zero in mjpeg.h */
+	memset(&hcode, 0, sizeof(struct hcode));
+
+	check(conv_htable_to_hcode(&source, &hcode) == 0, what);
+	check(memcmp(&hcode, expected, sizeof(struct hcode)) == 0, what);
+}
+
+/* the sizes that would wrap around with the block header */
+static void check_mem_overflow(void)
+{
+	check(mem_malloc(MEM_OTHER, SIZE_MAX) == NULL, "mem_malloc(SIZE_MAX) fails");
+	check(mem_malloc(MEM_OTHER, SIZE_MAX - 1) == NULL, "mem_malloc(SIZE_MAX - 1) fails");
+
+	uint8_t *ptr = mem_malloc(MEM_OTHER, 16);
+
+	if (ptr == NULL) {
+		check(0, "mem_malloc");
+		return;
+	}
+
+	memset(ptr, 0x55, 16);
+
+	check(mem_realloc(MEM_OTHER, ptr, SIZE_MAX) == NULL, "mem_realloc(SIZE_MAX) fails");
+	check(ptr[15] == 0x55, "the block is kept when mem_realloc() fails");
+
+	mem_free(MEM_OTHER, ptr);
+}
+
+int main(void)
+{
+	uint8_t data[WIDTH * HEIGHT * 3];
+
+	for (size_t i = 0; i < sizeof(data); ++i) {
+		data[i] = (uint8_t)(i * 7 + i / (WIDTH * 3) * 13);
+	}
+
+	struct jpeg_image image;
+
+	image.width = WIDTH;
+	image.height = HEIGHT;
+	image.components = 3;
+	image.precision = 8;
+	image.data = data;
+	image.buffer = NULL;
+
+	struct jpeg_params params;
+
+	jpeg_init_params(&params);
+
+	/* the reference, in a buffer allocated by the library */
+	void *ref = NULL;
+	size_t ref_size = 0;
+
+	if (jpeg_encode(&image, &params, &ref, &ref_size)) {
+		check(0, "encode into an allocated buffer");
+		return 1;
+	}
+
+	check(ref_size >= 4 && ((uint8_t *)ref)[ref_size - 2] == 0xff && ((uint8_t *)ref)[ref_size - 1] == 0xd9, "allocated buffer: EOI at the end");
+
+	check_caller_buffer(&image, &params, ref, ref_size, 0);
+	check_caller_buffer(&image, &params, ref, ref_size, +1);
+	check_caller_buffer(&image, &params, ref, ref_size, -1);
+
+	struct jpeg_image decoded;
+
+	if (jpeg_decode(ref, ref_size, &params, &decoded) == 0) {
+		check(decoded.width == WIDTH && decoded.height == HEIGHT && decoded.components == 3, "decode the geometry");
+		jpeg_free_image(&decoded);
+	} else {
+		check(0, "decode");
+	}
+
+	free(ref);
+
+	check_mjpeg_hcode(&mjpg_htable_0_0, &mjpg_hcode_0_0, "mjpg_hcode_0_0 derived from mjpg_htable_0_0");
+	check_mjpeg_hcode(&mjpg_htable_0_1, &mjpg_hcode_0_1, "mjpg_hcode_0_1 derived from mjpg_htable_0_1");
+	check_mjpeg_hcode(&mjpg_htable_1_0, &mjpg_hcode_1_0, "mjpg_hcode_1_0 derived from mjpg_htable_1_0");
+	check_mjpeg_hcode(&mjpg_htable_1_1, &mjpg_hcode_1_1, "mjpg_hcode_1_1 derived from mjpg_htable_1_1");
+
+	check_mem_overflow();
+
+	if (failures == 0) {
+		printf("all tests passed\n");
+	}
+
+	return failures != 0;
+}